@@ -0,0 +1,190 @@
+#include <QApplication>
+#include <QGraphicsView>
+#include <QMainWindow>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "ui_GeneralWindow.h"
+
+#include "dummyrpg/floor.hpp"
+#include "editor/project.hpp"
+#include "utils/definitions.hpp"
+#include "widgets/mapTools.hpp"
+#include "widgetsMap/chipsetGraphicsScene.hpp"
+#include "widgetsMap/mapGraphicsScene.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+//  MapSceneBench
+// Benchmarks of the map scene on synthetic maps. Sizes can be chosen with the
+// DUMMY_BENCH_SIZES environment variable (ex: "64,256,1024", in cells).
+// Run with -median N or -minimumvalue to get stable results.
+//////////////////////////////////////////////////////////////////////////////
+
+namespace {
+const int CHIPSET_CELLS = 16; // width and height (in cells) of the synthetic chipset
+
+std::vector<int> benchSizes()
+{
+    std::vector<int> sizes;
+    const QString envSizes = qEnvironmentVariable("DUMMY_BENCH_SIZES", "64,256,1024");
+    for (const QString& size : envSizes.split(','))
+        if (size.toInt() > 0)
+            sizes.push_back(size.toInt());
+    return sizes;
+}
+
+// Everything needed to display a map in a scene
+struct tBenchMap
+{
+    explicit tBenchMap(uint16_t size)
+        : project(std::make_shared<Editor::Project>(projectDir.path()))
+    {
+        QImage chipset(CHIPSET_CELLS * CELL_W, CHIPSET_CELLS * CELL_H, QImage::Format_ARGB32);
+        for (int y = 0; y < chipset.height(); ++y)
+            for (int x = 0; x < chipset.width(); ++x)
+                chipset.setPixel(x, y, qRgb(x, y, (x * y) % 256));
+
+        chipId = project->game().registerTileset("bench.png");
+        project->tileAtlas().setChipset(chipId, QPixmap::fromImage(chipset));
+        project->tileAtlas().setMapChipsets({chipId});
+
+        // Fill the map with various tiles, so the render is not trivial
+        map                        = std::make_shared<Dummy::Map>(size, size, chipId);
+        Dummy::GraphicLayer& layer = map->floorAt(0)->graphicLayersAt(0);
+        for (uint16_t y = 0; y < size; ++y)
+            for (uint16_t x = 0; x < size; ++x)
+                layer.set({x, y}, {static_cast<uint8_t>(x % CHIPSET_CELLS), static_cast<uint8_t>(y % CHIPSET_CELLS),
+                                   chipId});
+    }
+
+    void showMap(Editor::MapGraphicsScene& scene) const
+    {
+        scene.setMap(project, map);
+        while (scene.instantiateNextFloor()) {}
+        scene.revealRegion(QRectF(0, 0, map->width() * CELL_W, map->height() * CELL_H));
+    }
+
+    QTemporaryDir projectDir;
+    std::shared_ptr<Editor::Project> project;
+    std::shared_ptr<Dummy::Map> map;
+    Dummy::chip_id chipId = 0;
+};
+} // namespace
+
+class MapSceneBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void setMap_data() { addSizes(); }
+    void setMap()
+    {
+        QFETCH(int, size);
+        tBenchMap benchMap(static_cast<uint16_t>(size));
+        Editor::MapGraphicsScene scene;
+
+        QBENCHMARK { benchMap.showMap(scene); }
+    }
+
+    void updateTilesets_data() { addSizes(); }
+    void updateTilesets()
+    {
+        QFETCH(int, size);
+        tBenchMap benchMap(static_cast<uint16_t>(size));
+        Editor::MapGraphicsScene scene;
+        benchMap.showMap(scene);
+
+        QBENCHMARK {
+            for (const auto& layer : scene.graphicLayers())
+                layer->updateTilesets();
+        }
+    }
+
+    void commandPaint_data() { addSizes(); }
+    void commandPaint()
+    {
+        QFETCH(int, size);
+        tBenchMap benchMap(static_cast<uint16_t>(size));
+        Editor::MapGraphicsScene scene;
+        benchMap.showMap(scene);
+
+        QMainWindow window;
+        Ui::GeneralWindow ui;
+        ui.setupUi(&window);
+        ChipsetGraphicsScene chipsetScene;
+        Editor::MapTools tools(chipsetScene, scene, ui);
+        tools.setActiveLayer(*scene.graphicLayers()[0]);
+
+        // Copy the whole map, pasting it one cell aside is a full-map paint command that changes every cell
+        // (tiles follow the column, see tBenchMap)
+        scene.setSelectRect(QRect(0, 0, size * CELL_W, size * CELL_H));
+        tools.copyCut(Editor::MapTools::eCopyCut::Copy);
+        tools.setTool(Editor::MapTools::eTools::Paste);
+
+        QBENCHMARK {
+            tools.useTool(QRect(CELL_W, 0, 1, 1)); // execute
+            tools.undo();
+        }
+    }
+
+    void render_data() { addSizes(); }
+    void render()
+    {
+        QFETCH(int, size);
+        tBenchMap benchMap(static_cast<uint16_t>(size));
+        Editor::MapGraphicsScene scene;
+        benchMap.showMap(scene);
+
+        QGraphicsView view(&scene);
+        view.resize(1280, 720);
+        view.scale(0.5, 0.5); // display a big part of the map, as when zooming out
+
+        QImage target(view.size(), QImage::Format_ARGB32_Premultiplied);
+        QBENCHMARK {
+            QPainter painter(&target);
+            view.render(&painter);
+        }
+    }
+
+    void readMap_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::addColumn<bool>("isMapped");
+        for (int size : benchSizes()) {
+            QTest::newRow(QString("%1x%1 stream").arg(size).toUtf8().constData()) << size << false;
+            QTest::newRow(QString("%1x%1 mapped").arg(size).toUtf8().constData()) << size << true;
+        }
+    }
+    void readMap()
+    {
+        QFETCH(int, size);
+        QFETCH(bool, isMapped);
+        tBenchMap benchMap(static_cast<uint16_t>(size));
+        const QString mapPath = benchMap.projectDir.filePath("bench.map");
+        QVERIFY(Editor::Project::writeMap(mapPath, *benchMap.map));
+
+        const auto reading = isMapped ? Editor::Project::eMapReading::Mapped : Editor::Project::eMapReading::Stream;
+        QBENCHMARK { QVERIFY(Editor::Project::readMap(mapPath, reading) != nullptr); }
+    }
+
+private:
+    static void addSizes()
+    {
+        QTest::addColumn<int>("size");
+        for (int size : benchSizes())
+            QTest::newRow(QString("%1x%1").arg(size).toUtf8().constData()) << size;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    // Benchmarks must run without any display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    MapSceneBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "mapSceneBench.moc"
@@ -0,0 +1,59 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include <QFutureWatcher>
+#include <QTimer>
+#include <memory>
+
+#include "editor/project.hpp"
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  Autosaver class
+// The Autosaver periodically copies the current map and game data of a
+// modified project, and writes these copies into a recovery folder of the
+// project on a worker thread. A file is removed from the recovery as soon as
+// the project saves it, and the whole recovery once the project is saved (or
+// its changes dropped): a recovery is never older than the project files.
+//////////////////////////////////////////////////////////////////////////////
+
+class Autosaver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Autosaver(QObject* parent = nullptr);
+    virtual ~Autosaver() override;
+
+    void setProject(std::shared_ptr<Project>); // nullptr stops the autosave
+    void discardRecovery();                    // unsaved changes of the project are dropped
+
+    static bool hasRecovery(const QString& projectPath);
+    static bool restoreRecovery(const QString& projectPath); // overwritten files are kept in the backup folder
+    static void removeRecovery(const QString& projectPath);
+    static QString backupPath(const QString& projectPath);
+
+public slots:
+    void autosave();
+
+private:
+    void saveStatusChanged(bool isSaved);
+    void fileSaved(const QString& filePath);
+    void removeSavedFiles();
+    void autosaveDone();
+    void finishAutosave(); // waits for the worker, then handles its result
+
+    std::shared_ptr<Project> m_project;
+    QTimer m_timer;
+    bool m_hasNewChanges = false; // since the last autosave
+
+    QString m_savingPath;           // project being autosaved by the worker
+    bool m_isResultPending = false; // the worker started, its result is not handled yet
+    bool m_isRemovePending = false; // remove the recovery once the worker is done
+    QStringList m_savedFiles;       // saved while the worker was running, relative to the project
+    QFutureWatcher<bool> m_watcher;
+};
+
+} // namespace Editor
+
+#endif // AUTOSAVER_H
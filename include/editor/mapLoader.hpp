@@ -0,0 +1,60 @@
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <QFutureWatcher>
+#include <QImage>
+#include <atomic>
+#include <memory>
+
+#include "editor/project.hpp"
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  MapLoader class
+// The MapLoader reads a map file and decodes the images of its chipsets on
+// worker threads, so that the UI doesn't freeze while a big map is loaded.
+// Results are given back on the GUI thread through "loaded", and the Project
+// is left untouched until then.
+//////////////////////////////////////////////////////////////////////////////
+
+class MapLoader : public QObject
+{
+    Q_OBJECT
+public:
+    enum class eStep
+    {
+        ReadingMap,
+        DecodingChipsets,
+        Done, // = number of steps
+    };
+
+    explicit MapLoader(QObject* parent = nullptr);
+
+    void load(std::shared_ptr<Project>, const QString& mapName);
+    bool isLoading() const;
+
+public slots:
+    void cancel();
+
+signals:
+    void progressed(eStep);
+    void loaded(const QString& mapName, std::shared_ptr<Dummy::Map>, const std::vector<QImage>& chipsets);
+    void failed(const QString& mapName);
+
+private:
+    void mapRead();
+    void chipsetsDecoded();
+
+    std::shared_ptr<Project> m_project;
+    QString m_mapName;
+    std::shared_ptr<Dummy::Map> m_map;
+    std::shared_ptr<std::atomic<bool>> m_cancelled; // shared with the workers of the current load
+
+    QFutureWatcher<std::shared_ptr<Dummy::Map>> m_mapWatcher;
+    QFutureWatcher<std::vector<QImage>> m_chipsetsWatcher;
+};
+
+} // namespace Editor
+
+#endif // MAPLOADER_H
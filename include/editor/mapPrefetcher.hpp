@@ -0,0 +1,41 @@
+#ifndef MAPPREFETCHER_H
+#define MAPPREFETCHER_H
+
+#include <QStringList>
+#include <memory>
+
+#include "editor/mapLoader.hpp"
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  MapPrefetcher class
+// The MapPrefetcher loads, one after the other, the maps close to the current
+// one in the maps tree (parent, siblings and children) and puts them into the
+// maps cache of the Project. Reading and decoding happen on worker threads,
+// as for any map load, so opening one of them afterwards is instant.
+//////////////////////////////////////////////////////////////////////////////
+
+class MapPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MapPrefetcher(QObject* parent = nullptr);
+
+    void prefetchAround(std::shared_ptr<Project>, const QString& mapName);
+
+public slots:
+    void cancel();
+
+private:
+    void loadNext();
+    void mapLoaded(const QString& mapName, std::shared_ptr<Dummy::Map>, const std::vector<QImage>& chipsets);
+
+    std::shared_ptr<Project> m_project;
+    QStringList m_toLoad;
+    MapLoader m_loader;
+};
+
+} // namespace Editor
+
+#endif // MAPPREFETCHER_H
@@ -2,16 +2,24 @@
 #define EDITORPROJECT_H
 
 #include <QDomDocument>
+#include <QImage>
 #include <QStandardItem>
 #include <QString>
+#include <list>
 
 #include "dummyrpg/game.hpp"
+#include "editor/tileAtlas.hpp"
 
 namespace Editor {
 class MapsTreeModel;
 
 //////////////////////////////////////////////////////////////////////////////
 //  Project class
+// Each asset of the project (maps tree, current map, game data) remembers if
+// it was modified: a save only writes the dirty ones. Files are written into
+// a temporary file then renamed, so they are never left half-written.
+// Recently used maps are kept in memory (with their decoded chipsets) until
+// they exceed a memory budget, so going back to one of them is instant.
 //////////////////////////////////////////////////////////////////////////////
 struct tMapInfo
 {
@@ -22,51 +30,101 @@ struct tMapInfo
     uint16_t m_height = 0;
 };
 
+struct tCachedMap
+{
+    QString m_mapName;
+    std::shared_ptr<Dummy::Map> m_map; // nullptr if the map is not cached
+    std::vector<QImage> m_chipsets;    // may be empty if they were not decoded
+    size_t m_memoryUsage = 0;          // in bytes
+};
+
 class Project : public QObject
 {
     Q_OBJECT
 public:
+    static const size_t MAP_CACHE_BUDGET = 128 * 1024 * 1024; // in bytes, oldest used maps are forgotten above it
+
     explicit Project(const QString& folder);
 
     const QString& projectPath() const;
     const Dummy::GameStatic& game() const;
     Dummy::GameStatic& game();
     MapsTreeModel* mapsModel() const;
+    const TileAtlas& tileAtlas() const;
+    TileAtlas& tileAtlas();
     const Dummy::Map* currMap() const;
     Dummy::Map* currMap();
+    std::shared_ptr<Dummy::Map> sharedCurrMap() const; // for the ones that may outlive it as the current map
+    const QString& currMapName() const;
     bool isModified() const;
 
     void testMap();
 
     // Utils
-    void saveProject();
+    bool saveProject(); // returns false if an asset could not be written
     bool saveCurrMap();
-    void createMap(const tMapInfo& mapInfo, QStandardItem& parent);
+    bool createMap(const tMapInfo& mapInfo, QStandardItem& parent);
     bool loadMap(const QString& mapName);
+    // Returns false if the modified current map couldn't be saved: it then stays the current map
+    bool setCurrMap(const QString& mapName, std::shared_ptr<Dummy::Map> map, const std::vector<QImage>& chipsets = {});
+    tCachedMap cachedMap(const QString& mapName) const;
+    bool isMapCached(const QString& mapName) const;
+    // Adds a map loaded in advance, returns false if the cache is full
+    bool cacheMap(const QString& mapName, std::shared_ptr<Dummy::Map> map, const std::vector<QImage>& chipsets);
+    void forgetDecodedChipsets(); // chipset files changed, they must be decoded again
     bool mapExists(const QString& mapName);
+    QString mapPath(const QString& mapName) const;
+    QString gameDataPath() const;
+    std::vector<QString> chipsetPaths(const Dummy::Map&) const;
     bool renameCurrMap(const QString& newName);
 
     static QString sanitizeMapName(const QString& unsafeName);
+    enum class eMapReading
+    {
+        Mapped, // the file is mapped in memory and parsed in place
+        Stream, // the file is read through an ifstream
+    };
+    // thread-safe, doesn't use any project data
+    static std::shared_ptr<Dummy::Map> readMap(const QString& filePath, eMapReading = eMapReading::Mapped);
+
+    // Thread-safe, files are written atomically
+    static bool writeFile(const QString& path, const QByteArray& data);
+    static bool writeMap(const QString& path, const Dummy::Map&);
+    static bool writeGame(const QString& path, const Dummy::GameStatic&);
 
     static std::shared_ptr<Project> create(const QString& projectRootPath);
 
 public slots:
-    void changed();
+    void changed(); // game data changed
+    void mapChanged();
 
 signals:
     void saveStatusChanged(bool isSaved);
+    void fileSaved(const QString& filePath); // this file now holds the latest changes
 
 private:
     void dumpToXmlNode(QDomDocument& document, QDomElement& xmlNode, const QStandardItem* modelItem);
+    bool saveTree();
+    bool saveGame();
+    void updateSaveStatus();
+    bool cacheCurrMap(); // false if the current map is modified and couldn't be saved
+    void fitMapCacheInBudget();
 
 private:
     Dummy::GameStatic m_game;
-    bool m_isModified = false;
+    bool m_isTreeModified    = false;
+    bool m_isGameModified    = false;
+    bool m_isCurrMapModified = false;
 
     QString m_projectPath;
     QString m_currMapName;
     std::unique_ptr<MapsTreeModel> m_mapsModel;
     std::shared_ptr<Dummy::Map> m_currMap;
+    std::vector<QImage> m_currChipsets;
+    TileAtlas m_tileAtlas;
+
+    std::list<tCachedMap> m_mapCache; // most recently used first
+    size_t m_mapCacheBytes = 0;
 };
 
 } // namespace Editor
@@ -0,0 +1,67 @@
+#ifndef TILEATLAS_H
+#define TILEATLAS_H
+
+#include <QPixmap>
+#include <vector>
+
+#include "dummyrpg/dummy_types.hpp"
+#include "utils/definitions.hpp"
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  TileAtlas class
+// The TileAtlas packs the chipsets of a project into a single pixmap and
+// resolves a Tileaspect into the source rect to draw from in it. As every
+// tile comes from the same pixmap, a whole region can be drawn in one call.
+// Chipsets are stored in a table indexed by their id (ids are small and
+// dense), so resolving a tile is a table read and a bit of arithmetic.
+//////////////////////////////////////////////////////////////////////////////
+
+// Where the cells of a chipset are in the atlas
+struct tChipsetCells
+{
+    QPoint offset;
+    int width  = 0; // in cells
+    int height = 0; // in cells
+
+    bool contains(const Dummy::Tileaspect& aspect) const { return aspect.x < width && aspect.y < height; }
+    QRect source(const Dummy::Tileaspect& aspect) const
+    {
+        return QRect(offset.x() + aspect.x * CELL_W, offset.y() + aspect.y * CELL_H, CELL_W, CELL_H);
+    }
+};
+
+class TileAtlas
+{
+public:
+    bool setChipset(Dummy::chip_id, const QPixmap&); // returns false if this chipset was already set, same pixels
+    void setMapChipsets(const std::vector<Dummy::chip_id>&); // chipsets used by the current map
+
+    bool hasChipset(Dummy::chip_id) const;
+    tChipsetCells chipsetCells(Dummy::chip_id) const;
+    bool hasSingleChipset() const; // true if the current map uses only one chipset
+    Dummy::chip_id singleChipset() const;
+    const QPixmap& atlas() const;
+    QRect tileSource(const Dummy::Tileaspect&) const; // in the atlas, null if this tile can't be drawn
+
+private:
+    void pack() const;
+
+    struct tChipset
+    {
+        QPixmap pixmap;
+        uint contentHash = 0;
+        bool isSet       = false;
+        mutable tChipsetCells cells; // set when packing
+    };
+
+    std::vector<tChipset> m_chipsets; // indexed by chip id
+    std::vector<Dummy::chip_id> m_mapChipsets;
+    mutable QPixmap m_atlas;
+    mutable bool m_isPacked = true; // packing waits for the next use: chipsets are often set in a row
+};
+
+} // namespace Editor
+
+#endif // TILEATLAS_H
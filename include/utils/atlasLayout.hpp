@@ -0,0 +1,50 @@
+#ifndef ATLASLAYOUT_H
+#define ATLASLAYOUT_H
+
+#include <QRect>
+#include <algorithm>
+#include <vector>
+
+#include "utils/definitions.hpp"
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  AtlasLayout
+// Places sheets (ex: chipsets) one under the other in a single atlas, each
+// one starting on a cell boundary so that the grid of cells is kept. When a
+// column would get higher than maxHeight, the next sheets go to a new one.
+//////////////////////////////////////////////////////////////////////////////
+
+const int MAX_ATLAS_HEIGHT = 16384; // in pixels, pixmaps may not be bigger on some platforms
+
+struct tAtlasLayout
+{
+    std::vector<QRect> rects; // where each sheet is in the atlas, same order as the sheets
+    QSize size;
+};
+
+inline tAtlasLayout layoutAtlas(const std::vector<QSize>& sheets, int maxHeight = MAX_ATLAS_HEIGHT)
+{
+    auto toCellBoundary = [](int px, int cellPx) { return (px + cellPx - 1) / cellPx * cellPx; };
+
+    tAtlasLayout layout;
+    QPoint next(0, 0);
+    int columnWidth = 0;
+    for (const QSize& sheet : sheets) {
+        if (next.y() > 0 && next.y() + sheet.height() > maxHeight) {
+            next        = QPoint(next.x() + columnWidth, 0);
+            columnWidth = 0;
+        }
+        layout.rects.emplace_back(next, sheet);
+        layout.size = layout.size.expandedTo(QSize(next.x() + sheet.width(), next.y() + sheet.height()));
+
+        columnWidth = std::max(columnWidth, toCellBoundary(sheet.width(), CELL_W));
+        next.setY(next.y() + toCellBoundary(sheet.height(), CELL_H));
+    }
+    return layout;
+}
+
+} // namespace Editor
+
+#endif // ATLASLAYOUT_H
@@ -4,6 +4,8 @@
 const int CELL_W = 16;     // width of graphic cell
 const int CELL_H = CELL_W; // height of graphic cell
 
+const int CHUNK_SIZE = 32; // width and height (in cells) of a block of cells drawn by a single item
+
 const int Z_GRID    = 999;    // Z-level of the grid
 const int Z_SELEC   = 99'999; // Z-level of the selection
 const int Z_PREVIEW = 88'888; // Z-level of preview tiles
@@ -0,0 +1,53 @@
+#ifndef MEMORYSTREAMBUF_H
+#define MEMORYSTREAMBUF_H
+
+#include <streambuf>
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  MemoryStreamBuf class
+// A read-only streambuf over a buffer owned by someone else (ex: a mapped
+// file), so that an std::istream reads it without any copy or system call.
+// The buffer must outlive the streambuf.
+//////////////////////////////////////////////////////////////////////////////
+
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+    MemoryStreamBuf(const char* data, size_t size)
+    {
+        // The get area is never written, whatever the constness required by setg
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (! (which & std::ios_base::in))
+            return pos_type(off_type(-1));
+
+        off_type base = 0;
+        if (dir == std::ios_base::cur)
+            base = gptr() - eback();
+        else if (dir == std::ios_base::end)
+            base = egptr() - eback();
+
+        const off_type pos = base + off;
+        if (pos < 0 || pos > egptr() - eback())
+            return pos_type(off_type(-1));
+
+        setg(eback(), eback() + pos, egptr());
+        return pos_type(pos);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+} // namespace Editor
+
+#endif // MEMORYSTREAMBUF_H
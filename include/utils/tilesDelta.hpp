@@ -0,0 +1,71 @@
+#ifndef TILESDELTA_H
+#define TILESDELTA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  TilesDelta class
+// A TilesDelta remembers how a rect of cells changed, with only the cells
+// whose value actually changed. Consecutive changed cells (row by row) with
+// the same values are stored as a single run, so filling a big area with the
+// same tile over a uniform background costs a few bytes.
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename T> class TilesDelta
+{
+public:
+    // Both vectors hold the values of the same cells, row by row
+    void compute(const std::vector<T>& before, const std::vector<T>& after)
+    {
+        m_runs.clear();
+        const size_t nbCells = std::min(before.size(), after.size());
+        for (size_t i = 0; i < nbCells; ++i) {
+            if (before[i] == after[i])
+                continue;
+
+            if (! m_runs.empty()) {
+                tRun& last = m_runs.back();
+                if (last.start + last.length == i && last.before == before[i] && last.after == after[i]) {
+                    ++last.length;
+                    continue;
+                }
+            }
+            m_runs.push_back({static_cast<uint32_t>(i), 1, before[i], after[i]});
+        }
+        m_runs.shrink_to_fit();
+    }
+
+    void applyBefore(std::vector<T>& values) const
+    {
+        for (const tRun& run : m_runs)
+            std::fill_n(values.begin() + run.start, run.length, run.before);
+    }
+
+    void applyAfter(std::vector<T>& values) const
+    {
+        for (const tRun& run : m_runs)
+            std::fill_n(values.begin() + run.start, run.length, run.after);
+    }
+
+    bool isEmpty() const { return m_runs.empty(); }
+    size_t memoryUsage() const { return m_runs.capacity() * sizeof(tRun); } // in bytes
+
+private:
+    struct tRun
+    {
+        uint32_t start; // index of the first cell
+        uint32_t length;
+        T before;
+        T after;
+    };
+
+    std::vector<tRun> m_runs;
+};
+
+} // namespace Editor
+
+#endif // TILESDELTA_H
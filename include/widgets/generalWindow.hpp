@@ -2,8 +2,12 @@
 #define GENERALWINDOW_H
 
 #include <QMainWindow>
+#include <QProgressDialog>
 #include <memory>
 
+#include "editor/autosaver.hpp"
+#include "editor/mapLoader.hpp"
+#include "editor/mapPrefetcher.hpp"
 #include "editor/project.hpp"
 #include "utils/logger.hpp"
 #include "widgets/mapTools.hpp"
@@ -46,6 +50,7 @@ private slots:
     void on_actionEraser_triggered();
     void on_actionPen_triggered();
     void on_actionSelection_triggered();
+    void on_actionFreehand_toggled(bool);
     void on_actionToggleGrid_triggered();
     void on_actionCut_triggered();
     void on_actionCopy_triggered();
@@ -61,6 +66,11 @@ private slots:
     void layerVisibilityChanged(bool newVisibility, eLayerType type, uint8_t floorIdx, uint8_t layerIdx);
 
     void loadMap(const QString& mapName);
+    void mapLoadingProgressed(MapLoader::eStep);
+    void mapLoaded(const QString& mapName, std::shared_ptr<Dummy::Map>, const std::vector<QImage>& chipsets);
+    void mapLoadingFailed();
+    void instantiateNextFloor();
+    void revealVisibleMap();
     void placeCharToScene(Dummy::char_id);
     void addCharToFloor(Dummy::char_id, Dummy::Coord, uint8_t);
 
@@ -68,9 +78,13 @@ private slots:
 
 private:
     void closeEvent(QCloseEvent* event) override;
+    bool eventFilter(QObject* watched, QEvent* event) override;
     void updateProjectView();
     void updateMapsAndFloorsList();
     void updateChipsetsTab();
+    bool updateTileAtlas(); // returns true if a chipset changed
+    void showCurrMap(const std::vector<QImage>& decodedChipsets = {});
+    void currMapShown();
 
     void setupLoggers();
     void cleanLoggers();
@@ -83,6 +97,11 @@ private:
 
     std::shared_ptr<Editor::Project> m_loadedProject;
     std::vector<std::shared_ptr<Logger>> m_loggers;
+
+    MapLoader m_mapLoader;
+    MapPrefetcher m_mapPrefetcher;
+    std::unique_ptr<QProgressDialog> m_loadingDialog;
+    Autosaver m_autosaver;
 };
 
 // This is a wrapper around status bar to use log system
@@ -1,6 +1,7 @@
 #ifndef MAPTOOLS_H
 #define MAPTOOLS_H
 
+#include "utils/tilesDelta.hpp"
 #include "widgetsMap/chipsetGraphicsScene.hpp"
 #include "widgetsMap/mapGraphicsScene.hpp"
 
@@ -21,8 +22,9 @@ class Command
 {
 public:
     virtual ~Command() {}
-    virtual void execute() = 0;
-    virtual void undo()    = 0;
+    virtual void execute()             = 0;
+    virtual void undo()                = 0;
+    virtual size_t memoryUsage() const = 0; // in bytes, once executed
 };
 
 class MapTools : public QObject
@@ -44,6 +46,8 @@ public:
         Cut,
     };
 
+    static const size_t HISTORY_BUDGET = 64 * 1024 * 1024; // in bytes, oldest commands are forgotten above it
+
     explicit MapTools(const ChipsetGraphicsScene&, MapGraphicsScene&, Ui::GeneralWindow&);
 
     void clear();
@@ -59,6 +63,12 @@ public:
     void previewTool(const QRect& clickingRegion);
     void useTool(const QRect& clickingRegion);
 
+    // Freehand: pen and eraser paint the cells under the mouse, a whole stroke is a single command
+    void setFreehand(bool freehand = true);
+    bool beginStroke(const QPoint& pxCoord); // returns false if the current tool doesn't paint freehand
+    void continueStroke(const QPoint& pxCoord);
+    void endStroke();
+
     void copyCut(eCopyCut);
 
     void undo();
@@ -70,12 +80,13 @@ signals:
 private:
     void resetTools();
     void resetLayerLink();
+    void resetHistory();
 
     QPoint adjustOnGrid(const QPoint& pxCoords);
     QRect adjustOnGrid(const QRect& rawRect);
     void forceInScene(QPoint& point); // set the point in the scene if it's out
+    static QRect clipboardCells(const QPoint& pxCoord, uint16_t width, uint16_t height); // cells to paste on
 
-    QPixmap previewVisible(const QRect&);
 
     void drawBlocking(const QRect&);
     void drawVisible(const QRect&);
@@ -85,7 +96,13 @@ private:
 
     void paste(const QPoint&);
 
-    void doCommand(std::unique_ptr<Command>&& c);
+    void strokeAt(const QPoint& cell);
+    void strokeCell(Dummy::Coord, const Dummy::Tileaspect&);
+    void strokeCell(Dummy::Coord, bool isBlocking);
+
+    void doCommand(std::unique_ptr<Command>&& c, bool isExecuted = false);
+    void fitHistoryInBudget();
+    void updateUndoRedoUI();
 
     struct tVisibleClipboard
     {
@@ -101,12 +118,24 @@ private:
         std::vector<bool> content;
     };
 
+    // Buffers are kept from a stroke to another, so painting doesn't allocate anything
+    struct tStroke
+    {
+        bool isActive = false;
+        QPoint lastCell;
+        QRect bounds;              // of the cells painted
+        std::vector<bool> touched; // one per cell of the layer
+        std::vector<std::pair<uint32_t, Dummy::Tileaspect>> visibleBefore;
+        std::vector<std::pair<uint32_t, bool>> blockingBefore;
+    };
+
     const ChipsetGraphicsScene& m_chipsetScene;
     MapGraphicsScene& m_mapScene;
     Ui::GeneralWindow& m_toolsUI;
 
-    std::vector<std::unique_ptr<Command>> m_commandsHistory; // is reset each time we change the active layer
+    std::vector<std::unique_ptr<Command>> m_commandsHistory; // of the whole map, commands know which layer they edit
     size_t m_nbCommandsValid = 0;
+    size_t m_historyBytes    = 0;
 
     eTools m_currMode                = eTools::Selection;
     eLayerType m_currLayerType       = eLayerType::None;
@@ -114,6 +143,8 @@ private:
     LayerBlockingItems* m_blockLayer = nullptr;
     tVisibleClipboard m_visibleClipboard;
     tBlockingClipboard m_blockingClipboard;
+    bool m_isFreehand = false;
+    tStroke m_stroke;
 
     uint16_t m_uiLayerW   = 0;
     uint16_t m_uiLayerH   = 0;
@@ -125,29 +156,39 @@ private:
     class CommandPaint : public Command
     {
     public:
-        CommandPaint(MapTools& parent, QPoint&& pxCoord, tVisibleClipboard&& clip);
+        CommandPaint(MapTools& parent, const LayerGraphicItems& layer, QPoint&& pxCoord, tVisibleClipboard&& clip);
+        CommandPaint(MapTools& parent, const LayerGraphicItems& layer, const QRect& cells,
+                     TilesDelta<Dummy::Tileaspect>&& done); // already executed
         void execute() override;
         void undo() override;
+        size_t memoryUsage() const override;
 
     private:
         MapTools& m_parent;
-        QPoint m_position;
-        tVisibleClipboard m_toDraw;
-        tVisibleClipboard m_replacedTiles;
+        uint8_t m_floorIdx;
+        uint8_t m_layerIdx;
+        QRect m_cells;
+        tVisibleClipboard m_toDraw; // only until the first execution, then the delta is enough
+        TilesDelta<Dummy::Tileaspect> m_delta;
     };
 
     class CommandPaintBlocking : public Command
     {
     public:
-        CommandPaintBlocking(MapTools& parent, QPoint&& pxCoord, tBlockingClipboard&& clip);
+        CommandPaintBlocking(MapTools& parent, const LayerBlockingItems& layer, QPoint&& pxCoord,
+                             tBlockingClipboard&& clip);
+        CommandPaintBlocking(MapTools& parent, const LayerBlockingItems& layer, const QRect& cells,
+                             TilesDelta<bool>&& done); // already executed
         void execute() override;
         void undo() override;
+        size_t memoryUsage() const override;
 
     private:
         MapTools& m_parent;
-        QPoint m_position;
-        tBlockingClipboard m_toDraw;
-        tBlockingClipboard m_replacedTiles;
+        uint8_t m_floorIdx;
+        QRect m_cells;
+        tBlockingClipboard m_toDraw; // only until the first execution, then the delta is enough
+        TilesDelta<bool> m_delta;
     };
 };
 } // namespace Editor
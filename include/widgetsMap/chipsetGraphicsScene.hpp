@@ -3,12 +3,16 @@
 
 #include <QGraphicsRectItem>
 #include <QGraphicsScene>
+#include <QImage>
 #include <memory>
 
 #include "dummyrpg/dummy_types.hpp"
+#include "widgetsMap/gridItem.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
 //  ChipsetGraphicsScene class
+// The palette shows all the chipsets of a map, packed into a single pixmap.
+// A selection is always made inside one chipset.
 //////////////////////////////////////////////////////////////////////////////
 
 class ChipsetGraphicsScene : public QGraphicsScene
@@ -20,12 +24,13 @@ public:
     void mousePressEvent(QGraphicsSceneMouseEvent*) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent*) override;
 
-    const std::vector<QPixmap> chipsets() const { return {m_chipset}; }
-    const QRect& selectionRect() const { return m_currentSelection; }
+    const std::vector<QPixmap>& chipsets() const { return m_chipsets; } // same order as the ids given to setChipset
+    const QRect& selectionRect() const { return m_currentSelection; }   // in the chipset currId
     Dummy::chip_id currId() const { return m_currId; }
-    QPixmap selectionPixmap() const;
+    const QPixmap& selectionPixmap() const; // null if nothing is selected
 
-    void setChipset(const std::vector<QString>& chipsetPaths, const std::vector<Dummy::chip_id>& chipsetIds);
+    void setChipset(const std::vector<QString>& chipsetPaths, const std::vector<Dummy::chip_id>& chipsetIds,
+                    const std::vector<QImage>& decodedChipsets = {});
 
 public slots:
     void clear();
@@ -38,12 +43,16 @@ private:
     void setSelectRect(const QRect&);
 
 private:
-    QPixmap m_chipset;
+    std::vector<QPixmap> m_chipsets;
+    std::vector<QRect> m_chipRects; // where each chipset is in the palette
+    QPixmap m_palette;              // all the chipsets, packed into a single pixmap
     Dummy::chip_id m_currId = 0;
+    QRect m_currChipRect; // rect of the chipset currId in the palette
     std::unique_ptr<QGraphicsRectItem> m_selectionRectItem;
-    std::vector<std::unique_ptr<QGraphicsItem>> m_gridItems;
+    std::unique_ptr<Editor::GridItem> m_gridItem;
     bool m_isSelecting = false;
-    QRect m_currentSelection;
+    QRect m_currentSelection;          // in the chipset currId
+    mutable QPixmap m_selectionPixmap; // copied from the chipset on first use
     QPoint m_selectionStart;
 
     std::vector<QString> m_chipPaths;
@@ -0,0 +1,44 @@
+#ifndef FLOORCACHEITEM_H
+#define FLOORCACHEITEM_H
+
+#include <QGraphicsItem>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////
+//  forward declaration
+//////////////////////////////////////////////////////////////////////////////
+
+namespace Editor {
+class MapSceneLayer;
+
+//////////////////////////////////////////////////////////////////////////////
+//  FloorCacheItem class
+// A FloorCacheItem draws all the layers of a floor that is not being edited.
+// Layers are flattened chunk by chunk into pixmaps kept in the QPixmapCache,
+// so an inactive floor costs one item and a few pixmaps instead of one item
+// per chunk and per layer. A pixmap is rendered again only when one of the
+// layers changed (see MapSceneLayer::revision).
+//////////////////////////////////////////////////////////////////////////////
+
+class FloorCacheItem : public QGraphicsItem
+{
+public:
+    explicit FloorCacheItem(uint16_t floorW, uint16_t floorH);
+
+    void addLayer(const MapSceneLayer&); // layers must be added from the lowest to the highest
+
+    QRectF boundingRect() const override;
+    void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
+
+private:
+    uint64_t revision() const;
+    QPixmap chunkPixmap(const QRect& cells) const;
+
+    const uint64_t m_cacheId; // unique among all the caches, to build the pixmap keys
+    uint16_t m_floorW;
+    uint16_t m_floorH;
+    std::vector<const MapSceneLayer*> m_layers;
+};
+} // namespace Editor
+
+#endif // FLOORCACHEITEM_H
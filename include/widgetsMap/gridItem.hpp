@@ -0,0 +1,33 @@
+#ifndef GRIDITEM_H
+#define GRIDITEM_H
+
+#include <QGraphicsItem>
+#include <QPen>
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  GridItem class
+// A GridItem draws a whole grid by itself, only painting the lines crossing
+// the exposed area. When zoomed out enough for the cells to be tiny on the
+// screen, it doesn't draw anything.
+//////////////////////////////////////////////////////////////////////////////
+
+class GridItem : public QGraphicsItem
+{
+public:
+    explicit GridItem(const QPen& pen);
+
+    void setGrid(const QSize& sizePx, const QSize& cellSizePx);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
+
+private:
+    QPen m_pen;
+    QSize m_size;     // in pixels
+    QSize m_cellSize; // in pixels
+};
+} // namespace Editor
+
+#endif // GRIDITEM_H
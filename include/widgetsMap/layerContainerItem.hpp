@@ -0,0 +1,32 @@
+#ifndef LAYERCONTAINERITEM_H
+#define LAYERCONTAINERITEM_H
+
+#include <QGraphicsItem>
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  LayerContainerItem class
+// A LayerContainerItem is the parent of all the items of a layer. Unlike a
+// QGraphicsItemGroup, its bounding rect is fixed by the layer dimensions and
+// is never recomputed when children are added or removed.
+//////////////////////////////////////////////////////////////////////////////
+
+class LayerContainerItem : public QGraphicsItem
+{
+public:
+    LayerContainerItem();
+
+    void setSize(const QSize& sizePx);
+    void addChild(QGraphicsItem*);
+    void clearChildren();
+
+    QRectF boundingRect() const override;
+    void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
+
+private:
+    QSize m_size; // in pixels
+};
+} // namespace Editor
+
+#endif // LAYERCONTAINERITEM_H
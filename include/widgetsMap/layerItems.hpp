@@ -1,16 +1,19 @@
 #ifndef GRAPHICLAYER_H
 #define GRAPHICLAYER_H
 
-#include <QGraphicsItemGroup>
+#include <QImage>
 
 #include "dummyrpg/floor.hpp"
+#include "editor/tileAtlas.hpp"
 #include "utils/definitions.hpp"
+#include "widgetsMap/layerContainerItem.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
 //  forward declaration
 //////////////////////////////////////////////////////////////////////////////
 
 namespace Editor {
+class TileChunkItem;
 
 //////////////////////////////////////////////////////////////////////////////
 //  GraphicLayer class
@@ -21,20 +24,53 @@ class MapSceneLayer : public QObject
 public:
     explicit MapSceneLayer(uint8_t floorIdx, uint8_t layerIdx, int zIndex);
 
-    QGraphicsItemGroup* graphicItems() { return m_items; }
+    LayerContainerItem* graphicItems() { return m_items; }
     void clear();
     void setVisibility(bool);
+    bool isVisible() const { return m_isVisible; }
     bool isThisFloor(uint8_t floorIdx) const;
     bool isThisLayer(uint8_t floorIdx, uint8_t layerIdx) const;
+    uint8_t floorIdx() const { return m_floorIdx; }
+    uint8_t layerIdx() const { return m_layerIdx; }
+    int zIndex() const;
+
+    // Items are created chunk by chunk, only when a chunk is revealed (= is close to the view)
+    void reveal(const QRect& cellsRegion);
+    // A collapsed layer has no item at all, its content is drawn by someone else (a floor cache)
+    void setCollapsed(bool);
+
+    virtual void paintCells(QPainter&, const QRect& cellsRegion) const;
+    uint64_t revision() const { return m_revision; } // changes each time the content or visibility changes
 
 protected:
     std::vector<QGraphicsItem*>& indexedItems() { return m_indexedItems; }
 
+    void setSize(uint16_t layerW, uint16_t layerH);
+    void setupChunks(uint16_t layerW, uint16_t layerH);
+    size_t nbChunks() const { return m_builtChunks.size(); }
+    size_t chunkIndex(Dummy::Coord) const;
+    QRect layerRect() const { return QRect(0, 0, m_layerW, m_layerH); } // in cells units
+    bool isChunkBuilt(Dummy::Coord) const;
+    virtual void buildChunk(size_t chunkIdx, const QRect& cells);
+    virtual void chunksReleased();
+    void touch();
+
 private:
+    void releaseChunks();
+
     uint8_t m_floorIdx;
     uint8_t m_layerIdx;
-    QGraphicsItemGroup* m_items = new QGraphicsItemGroup();
+    LayerContainerItem* m_items = new LayerContainerItem(); // owned by the scene once added
     std::vector<QGraphicsItem*> m_indexedItems;
+    bool m_isVisible    = true;
+    bool m_isCollapsed  = false;
+    uint64_t m_revision = 0;
+
+    uint16_t m_layerW    = 0;
+    uint16_t m_layerH    = 0;
+    uint16_t m_nbChunksW = 0;
+    uint16_t m_nbChunksH = 0;
+    std::vector<bool> m_builtChunks;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -42,18 +78,28 @@ private:
 class LayerGraphicItems : public MapSceneLayer
 {
 public:
-    explicit LayerGraphicItems(Dummy::GraphicLayer& layer, const std::vector<QPixmap>& chipses,
-                               const std::vector<Dummy::chip_id>& chipsetIds, uint8_t floorIdx, uint8_t layerIdx,
+    explicit LayerGraphicItems(Dummy::GraphicLayer& layer, const TileAtlas& atlas, uint8_t floorIdx, uint8_t layerIdx,
                                int zIndex);
     void setTile(Dummy::Coord, Dummy::Tileaspect);
-    void updateTilesets(const std::vector<QPixmap>& chipsets, const std::vector<Dummy::chip_id>& chipsetIds);
+    // Values are given row by row. Cells out of the layer are ignored (and read as undefAspect)
+    void setTiles(const QRect& cells, const std::vector<Dummy::Tileaspect>& values);
+    std::vector<Dummy::Tileaspect> tiles(const QRect& cells) const;
+    void updateTilesets();
     const Dummy::GraphicLayer& layer();
 
+    void paintCells(QPainter&, const QRect& cellsRegion) const override; // used by chunks to draw themselves
+
+protected:
+    void buildChunk(size_t chunkIdx, const QRect& cells) override;
+    void chunksReleased() override;
+
 private:
-    size_t idxOfId(Dummy::chip_id);
+    TileChunkItem* chunkAt(Dummy::Coord) const;
+    Dummy::Tileaspect validAspect(const Dummy::Tileaspect&) const;
+
     Dummy::GraphicLayer& m_graphicLayer;
-    std::vector<QPixmap> m_chipsets;
-    std::vector<Dummy::chip_id> m_chipsetIds;
+    const TileAtlas& m_atlas;             // shared by all the layers of the project
+    std::vector<TileChunkItem*> m_chunks; // owned by the group, nullptr until the chunk is revealed
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -61,14 +107,31 @@ private:
 class LayerBlockingItems : public MapSceneLayer
 {
 public:
-    explicit LayerBlockingItems(Dummy::BlockingLayer& layer, uint8_t floorIdx, uint8_t layerIdx, int zIndex);
+    // The mask is built from the layer if not given (see buildMask)
+    explicit LayerBlockingItems(Dummy::BlockingLayer& layer, uint8_t floorIdx, uint8_t layerIdx, int zIndex,
+                                QImage mask = QImage());
+    static QImage buildMask(const Dummy::BlockingLayer&); // thread-safe, can be called by workers
 
     void toogleTile(Dummy::Coord);
     void setTile(Dummy::Coord, bool);
+    // Values are given row by row. Cells out of the layer are ignored (and read as not blocking)
+    void setTiles(const QRect& cells, const std::vector<bool>& values);
+    std::vector<bool> tiles(const QRect& cells) const;
     const Dummy::BlockingLayer& layer();
 
+    void paintCells(QPainter&, const QRect& cellsRegion) const override; // used by the mask item to draw itself
+
+protected:
+    void buildChunk(size_t chunkIdx, const QRect& cells) override;
+    void chunksReleased() override;
+
 private:
+    static void setMaskBit(QImage& mask, Dummy::Coord, bool isBlock);
+    void invalidateCells(const QRect& cells);
+
     Dummy::BlockingLayer& m_blockingLayer;
+    QImage m_mask;                       // 1 bit per cell, painted scaled to the cells size
+    TileChunkItem* m_maskItem = nullptr; // owned by the container, draws the whole layer
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1,14 +1,19 @@
 #ifndef MAPGRAPHICSSCENE_H
 #define MAPGRAPHICSSCENE_H
 
+#include <QFuture>
 #include <QGraphicsPixmapItem>
 #include <QGraphicsScene>
+#include <QTimer>
 #include <memory>
 
 #include "dummyrpg/map.hpp"
 #include "editor/project.hpp"
+#include "widgetsMap/floorCacheItem.hpp"
 #include "widgetsMap/graphicItem.hpp"
+#include "widgetsMap/gridItem.hpp"
 #include "widgetsMap/layerItems.hpp"
+#include "widgetsMap/previewItem.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
 //  forward declaration
@@ -33,14 +38,20 @@ public:
     explicit MapGraphicsScene(QObject* parent = nullptr);
     virtual ~MapGraphicsScene() override;
 
-    void setMap(std::shared_ptr<Project> p, const Dummy::Map&, const std::vector<QPixmap>& chipsets);
-    void setCurrFloor(uint8_t); // doesn't visually set the layer but only prepare the link for "add charac" action
-    void setPreview(const QPixmap& previewPix, const QPoint& pos);
+    // Floors are then added by instantiateNextFloor
+    void setMap(std::shared_ptr<Project> p, std::shared_ptr<Dummy::Map>);
+    bool instantiateNextFloor(); // returns false if there was no floor left to instantiate
+    bool hasFloorsToInstantiate() const;
+    void setCurrFloor(uint8_t); // only the current floor is editable, the others are drawn from a cache
+    void setPreview(const QRect& rect, const QPixmap& pattern); // pattern is repeated over the rect
+    void setPreview(const QRect& rect, const QColor& color);
     void setSelectRect(const QRect& selectionRect);
     void setLocationCharacter(const QPoint&, Dummy::char_id);
     void drawGrid(quint16 width, quint16 height, unsigned int unit);
     void linkToolSet(MapTools* tools) { m_tools = tools; }
-    void updateTilesets(const std::vector<QPixmap>& chipsets, const std::vector<Dummy::chip_id>& chipsetIds);
+    void updateTilesets();
+    void revealRegion(const QRectF& viewedRect); // instantiate the layers content around what is viewed
+    void refreshFloor(uint8_t floorIdx);           // to call when a layer of this floor changed from outside
 
     QRectF selectionRect();
 
@@ -51,6 +62,8 @@ public:
 
     const vec_uniq<LayerGraphicItems>& graphicLayers() const;
     const vec_uniq<LayerBlockingItems>& blockingLayers() const;
+    LayerGraphicItems* graphicLayer(uint8_t floorIdx, uint8_t layerIdx) const; // nullptr if not instantiated
+    LayerBlockingItems* blockingLayer(uint8_t floorIdx) const;                  // nullptr if not instantiated
 
     void mousePressEvent(QGraphicsSceneMouseEvent*) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent*) override;
@@ -65,21 +78,26 @@ signals:
     void characterPlacedOnFloor(Dummy::char_id, Dummy::Coord, uint8_t floor);
 
 private:
-    void instantiateFloor(Dummy::Floor&, const std::vector<QPixmap>& chips,
-                          const std::vector<Dummy::chip_id>& chipsetIds, uint8_t floorId, int& zIdxInOut);
+    void instantiateFloor(Dummy::Floor&, const TileAtlas& atlas, const QImage& blockingMask, uint8_t floorId,
+                          int& zIdxInOut);
     Dummy::Coord scenePosToCoord(const QPoint& p) const;
     Dummy::CharacterInstance* npcAt(Dummy::Coord);
+    PreviewItem& previewItem(const QRect&); // shown, at this rect
+    void previewTool(const QRect& clickingRegion); // rate limited
+    void showPendingPreview();
 
     // Layers
     vec_uniq<LayerGraphicItems> m_visibleLayers;
     vec_uniq<LayerBlockingItems> m_blockingLayers;
     vec_uniq<LayerObjectItems> m_objectsLayers;
+    std::vector<FloorCacheItem*> m_floorCaches; // owned by the scene, one per floor
 
     // Tools
     enum class eMode
     {
         None,
         Tool,
+        Stroke,
         AddChar
     };
     MapTools* m_tools = nullptr;
@@ -88,11 +106,20 @@ private:
     Dummy::char_id m_charBeingAdded = Dummy::undefChar;
     uint8_t m_activeFloor           = 0;
     std::shared_ptr<Project> m_loadedProject;
+    QTimer m_previewTimer; // running while a new preview would come too early
+    QRect m_pendingPreview;
+    bool m_hasPendingPreview = false;
+
+    // Progressive instantiation
+    const Dummy::Map* m_mapToInstantiate = nullptr;
+    uint8_t m_nbFloorsInstantiated       = 0;
+    int m_nextZIndex                     = 0;
+    QFuture<QImage> m_blockingMasks; // one per floor, built by workers while the previous floors are added
 
     // QGraphicsScene deletes those
-    vec_uniq<QGraphicsItem> m_gridItems;
+    std::unique_ptr<GridItem> m_gridItem;
     std::unique_ptr<QGraphicsRectItem> m_selectionRectItem; // when seleting tiles
-    std::unique_ptr<QGraphicsPixmapItem> m_previewTileItem; // when drawing tiles
+    std::unique_ptr<PreviewItem> m_previewItem;             // when drawing tiles
     std::unique_ptr<GraphicItem> m_locationIndicatorItem;   // when placing a character or item
 };
 } // namespace Editor
@@ -65,6 +65,7 @@ public:
     explicit MapsTreeModel(const QDomNode& mapsNode);
     QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     void renameNode(const QString& oldName, const QString& newName);
+    QStringList neighbourMaps(const QString& mapName) const; // parent, siblings and children
 
 private:
     void XmlMapToQItem(const QDomNode& mapsNode, QStandardItem* parent);
@@ -0,0 +1,36 @@
+#ifndef PREVIEWITEM_H
+#define PREVIEWITEM_H
+
+#include <QBrush>
+#include <QGraphicsItem>
+
+namespace Editor {
+
+//////////////////////////////////////////////////////////////////////////////
+//  PreviewItem class
+// A PreviewItem shows what a tool is about to draw: a rect filled with a
+// color, or with a pattern repeated from its top-left corner. The same item
+// is kept while the mouse moves, only its rect changes: nothing is allocated
+// whatever the size of the rect.
+//////////////////////////////////////////////////////////////////////////////
+
+class PreviewItem : public QGraphicsItem
+{
+public:
+    PreviewItem();
+
+    void setRect(const QRect& rect); // in pixels
+    void setPattern(const QPixmap& pattern);
+    void setColor(const QColor& color);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
+
+private:
+    QRect m_rect;
+    QBrush m_brush;
+    qint64 m_patternKey = 0; // cacheKey of the pattern, 0 if filled with a color
+};
+} // namespace Editor
+
+#endif // PREVIEWITEM_H
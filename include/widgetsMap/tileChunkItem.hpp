@@ -0,0 +1,39 @@
+#ifndef TILECHUNKITEM_H
+#define TILECHUNKITEM_H
+
+#include <QGraphicsItem>
+
+#include "dummyrpg/dummy_types.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+//  forward declaration
+//////////////////////////////////////////////////////////////////////////////
+
+namespace Editor {
+class MapSceneLayer;
+
+//////////////////////////////////////////////////////////////////////////////
+//  TileChunkItem class
+// A TileChunkItem draws a block of cells of a layer. It does not own any
+// pixmap: cells are painted straight from the layer (chipsets, blocking mask),
+// so the scene only contains one item per chunk instead of one per cell.
+//////////////////////////////////////////////////////////////////////////////
+
+class TileChunkItem : public QGraphicsItem
+{
+public:
+    explicit TileChunkItem(const MapSceneLayer& layer, const QRect& cells);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
+
+    const QRect& cells() const { return m_cells; }
+    void invalidateCell(Dummy::Coord);
+
+private:
+    const MapSceneLayer& m_layer;
+    QRect m_cells; // in cells units
+};
+} // namespace Editor
+
+#endif // TILECHUNKITEM_H
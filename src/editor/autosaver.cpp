@@ -0,0 +1,220 @@
+#include "editor/autosaver.hpp"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QtConcurrent>
+
+#include "utils/logger.hpp"
+
+static const int AUTOSAVE_INTERVAL_MS = 2 * 60 * 1000;
+static const char* const RECOVERY_DIR = ".autosave";
+static const char* const BACKUP_DIR   = ".autosave.bak";
+
+namespace Editor {
+
+static QString recoveryPath(const QString& projectPath)
+{
+    return projectPath + "/" + RECOVERY_DIR;
+}
+
+Autosaver::Autosaver(QObject* parent)
+    : QObject(parent)
+{
+    m_timer.setInterval(AUTOSAVE_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &Autosaver::autosave);
+    connect(&m_watcher, &QFutureWatcherBase::finished, this, &Autosaver::autosaveDone);
+}
+
+Autosaver::~Autosaver()
+{
+    // Left alone, the worker could still write a recovery of a project saved in the meantime
+    finishAutosave();
+}
+
+void Autosaver::setProject(std::shared_ptr<Project> project)
+{
+    finishAutosave();
+    if (m_project != nullptr)
+        disconnect(m_project.get(), nullptr, this, nullptr);
+
+    m_project       = project;
+    m_hasNewChanges = false;
+    m_savedFiles.clear();
+    if (m_project == nullptr) {
+        m_timer.stop();
+        return;
+    }
+
+    connect(m_project.get(), &Project::saveStatusChanged, this, &Autosaver::saveStatusChanged);
+    connect(m_project.get(), &Project::fileSaved, this, &Autosaver::fileSaved);
+    m_timer.start();
+}
+
+void Autosaver::discardRecovery()
+{
+    if (m_project == nullptr)
+        return;
+
+    m_hasNewChanges = false;
+    if (m_watcher.isRunning() && m_savingPath == m_project->projectPath())
+        m_isRemovePending = true;
+    else
+        removeRecovery(m_project->projectPath());
+}
+
+void Autosaver::saveStatusChanged(bool isSaved)
+{
+    if (isSaved)
+        discardRecovery(); // the project files are up to date
+    else
+        m_hasNewChanges = true;
+}
+
+void Autosaver::fileSaved(const QString& filePath)
+{
+    // The recovered copy is now older than the project file, restoring it would drop the newer changes
+    m_savedFiles << QDir(m_project->projectPath()).relativeFilePath(filePath);
+    if (! m_watcher.isRunning())
+        removeSavedFiles();
+}
+
+void Autosaver::removeSavedFiles()
+{
+    if (m_project == nullptr) {
+        m_savedFiles.clear();
+        return;
+    }
+
+    const QDir recoveryDir(recoveryPath(m_project->projectPath()));
+    for (const QString& file : m_savedFiles)
+        QFile::remove(recoveryDir.filePath(file));
+    m_savedFiles.clear();
+}
+
+void Autosaver::autosave()
+{
+    if (m_project == nullptr || ! m_hasNewChanges || m_watcher.isRunning())
+        return;
+
+    // The new snapshot is taken after these saves, but may not replace the files they concern
+    if (! m_savedFiles.isEmpty())
+        removeSavedFiles();
+
+    // Snapshots are taken on the GUI thread, the worker only serializes them
+    const QDir projectDir(m_project->projectPath());
+    const QString gameFile = projectDir.relativeFilePath(m_project->gameDataPath());
+    auto game              = std::make_shared<Dummy::GameStatic>(m_project->game());
+
+    QString mapFile;
+    std::shared_ptr<Dummy::Map> map;
+    if (m_project->currMap() != nullptr) {
+        mapFile = projectDir.relativeFilePath(m_project->mapPath(m_project->currMapName()));
+        map     = std::make_shared<Dummy::Map>(*m_project->currMap());
+    }
+
+    m_hasNewChanges   = false;
+    m_isRemovePending = false;
+    m_savingPath      = projectDir.path();
+    m_isResultPending = true;
+
+    const QString recoveryDir = recoveryPath(m_savingPath);
+    m_watcher.setFuture(QtConcurrent::run([recoveryDir, gameFile, game, mapFile, map]() {
+        // Written aside: the previous recovery is only replaced by a complete one
+        QDir newDir(recoveryDir + ".new");
+        newDir.removeRecursively();
+
+        bool bRes = newDir.mkpath(QFileInfo(gameFile).path());
+        bRes      = bRes && Project::writeGame(newDir.filePath(gameFile), *game);
+        if (map != nullptr) {
+            bRes = bRes && newDir.mkpath(QFileInfo(mapFile).path());
+            bRes = bRes && Project::writeMap(newDir.filePath(mapFile), *map);
+        }
+        if (! bRes)
+            return false;
+
+        QDir(recoveryDir).removeRecursively();
+        return QDir().rename(newDir.path(), recoveryDir);
+    }));
+}
+
+void Autosaver::autosaveDone()
+{
+    if (! m_isResultPending)
+        return; // already handled by finishAutosave
+    m_isResultPending = false;
+
+    if (m_isRemovePending) {
+        m_isRemovePending = false;
+        removeRecovery(m_savingPath);
+        m_savedFiles.clear();
+        return;
+    }
+    removeSavedFiles();
+
+    if (m_watcher.result())
+        Log::debug(tr("Project autosaved in %1").arg(recoveryPath(m_savingPath)));
+    else
+        Log::error(tr("Error while autosaving the project"));
+}
+
+void Autosaver::finishAutosave()
+{
+    if (! m_isResultPending)
+        return;
+
+    m_watcher.waitForFinished();
+    autosaveDone();
+}
+
+bool Autosaver::hasRecovery(const QString& projectPath)
+{
+    // All its files may have been saved since
+    return QDirIterator(recoveryPath(projectPath), QDir::Files, QDirIterator::Subdirectories).hasNext();
+}
+
+bool Autosaver::restoreRecovery(const QString& projectPath)
+{
+    const QDir recoveryDir(recoveryPath(projectPath));
+    QDir backupDir(backupPath(projectPath));
+    backupDir.removeRecursively();
+    bool bRes = true;
+
+    QDirIterator it(recoveryDir.path(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString filePath     = it.next();
+        const QString relativePath = recoveryDir.relativeFilePath(filePath);
+        const QString projectFile  = projectPath + "/" + relativePath;
+        const QString backupFile   = backupDir.filePath(relativePath);
+
+        // The project file is kept aside, in case the recovered one is not the wanted one
+        if (QFile::exists(projectFile)
+            && ! (backupDir.mkpath(QFileInfo(relativePath).path()) && QFile::copy(projectFile, backupFile))) {
+            Log::error(tr("Error while backing up %1, it is not restored").arg(projectFile));
+            bRes = false;
+            continue;
+        }
+
+        QFile recoveredFile(filePath);
+        const bool isRead = recoveredFile.open(QIODevice::ReadOnly);
+        if (! isRead || ! Project::writeFile(projectFile, recoveredFile.readAll())) {
+            Log::error(tr("Error while restoring %1").arg(filePath));
+            bRes = false;
+        }
+    }
+
+    if (bRes)
+        removeRecovery(projectPath);
+    return bRes;
+}
+
+void Autosaver::removeRecovery(const QString& projectPath)
+{
+    QDir(recoveryPath(projectPath)).removeRecursively();
+}
+
+QString Autosaver::backupPath(const QString& projectPath)
+{
+    return projectPath + "/" + BACKUP_DIR;
+}
+
+} // namespace Editor
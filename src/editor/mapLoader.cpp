@@ -0,0 +1,99 @@
+#include "editor/mapLoader.hpp"
+
+#include <QtConcurrent>
+
+#include "utils/logger.hpp"
+
+namespace Editor {
+
+MapLoader::MapLoader(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_mapWatcher, &QFutureWatcherBase::finished, this, &MapLoader::mapRead);
+    connect(&m_chipsetsWatcher, &QFutureWatcherBase::finished, this, &MapLoader::chipsetsDecoded);
+}
+
+void MapLoader::load(std::shared_ptr<Project> project, const QString& mapName)
+{
+    cancel();
+    if (project == nullptr)
+        return;
+
+    m_project   = project;
+    m_mapName   = mapName;
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    // Only copies are given to the worker, it doesn't touch the project
+    const QString mapPath = project->mapPath(mapName);
+    auto cancelled        = m_cancelled;
+    m_mapWatcher.setFuture(QtConcurrent::run([mapPath, cancelled]() -> std::shared_ptr<Dummy::Map> {
+        if (*cancelled)
+            return nullptr;
+        return Project::readMap(mapPath);
+    }));
+
+    emit progressed(eStep::ReadingMap);
+}
+
+bool MapLoader::isLoading() const
+{
+    return m_cancelled != nullptr && ! *m_cancelled && m_project != nullptr;
+}
+
+void MapLoader::cancel()
+{
+    if (m_cancelled != nullptr)
+        *m_cancelled = true;
+
+    // Results of a cancelled load must never be taken for the ones of the next load
+    m_mapWatcher.setFuture(QFuture<std::shared_ptr<Dummy::Map>>());
+    m_chipsetsWatcher.setFuture(QFuture<std::vector<QImage>>());
+
+    m_project.reset();
+    m_map.reset();
+}
+
+void MapLoader::mapRead()
+{
+    if (! isLoading())
+        return;
+
+    m_map = m_mapWatcher.result();
+    if (m_map == nullptr) {
+        Log::error(tr("Error while loading the map %1").arg(m_project->mapPath(m_mapName)));
+        cancel();
+        emit failed(m_mapName);
+        return;
+    }
+
+    // Chipset paths depend on the game data: resolve them here, on the GUI thread
+    const std::vector<QString> chipsetPaths = m_project->chipsetPaths(*m_map);
+    auto cancelled                          = m_cancelled;
+    m_chipsetsWatcher.setFuture(QtConcurrent::run([chipsetPaths, cancelled]() {
+        std::vector<QImage> chipsets;
+        for (const auto& path : chipsetPaths) {
+            if (*cancelled)
+                break;
+            chipsets.emplace_back(path);
+        }
+        return chipsets;
+    }));
+
+    emit progressed(eStep::DecodingChipsets);
+}
+
+void MapLoader::chipsetsDecoded()
+{
+    // The map is read first: without it, this is the end of a detached future
+    if (! isLoading() || m_map == nullptr)
+        return;
+
+    const QString mapName = m_mapName;
+    auto map              = m_map;
+    auto chipsets         = m_chipsetsWatcher.result();
+    cancel(); // loading is over
+
+    emit loaded(mapName, map, chipsets);
+}
+
+} // namespace Editor
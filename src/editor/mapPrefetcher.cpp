@@ -0,0 +1,60 @@
+#include "editor/mapPrefetcher.hpp"
+
+#include "widgetsMap/mapsTree.hpp"
+
+namespace Editor {
+
+MapPrefetcher::MapPrefetcher(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_loader, &MapLoader::loaded, this, &MapPrefetcher::mapLoaded);
+    connect(&m_loader, &MapLoader::failed, this, &MapPrefetcher::loadNext);
+}
+
+void MapPrefetcher::prefetchAround(std::shared_ptr<Project> project, const QString& mapName)
+{
+    cancel();
+    if (project == nullptr || project->mapsModel() == nullptr)
+        return;
+
+    m_project = project;
+    m_toLoad  = project->mapsModel()->neighbourMaps(mapName);
+    loadNext();
+}
+
+void MapPrefetcher::cancel()
+{
+    m_loader.cancel();
+    m_toLoad.clear();
+    m_project.reset();
+}
+
+void MapPrefetcher::loadNext()
+{
+    if (m_project == nullptr)
+        return;
+
+    // Maps may have been opened or cached since the prefetch was asked
+    while (! m_toLoad.isEmpty()) {
+        const QString mapName = m_toLoad.takeFirst();
+        if (mapName != m_project->currMapName() && ! m_project->isMapCached(mapName)) {
+            m_loader.load(m_project, mapName);
+            return;
+        }
+    }
+    m_project.reset(); // nothing left to load
+}
+
+void MapPrefetcher::mapLoaded(const QString& mapName, std::shared_ptr<Dummy::Map> map,
+                              const std::vector<QImage>& chipsets)
+{
+    if (m_project == nullptr)
+        return;
+
+    if (m_project->cacheMap(mapName, map, chipsets))
+        loadNext();
+    else
+        cancel(); // the cache is full, next maps wouldn't be kept either
+}
+
+} // namespace Editor
@@ -2,11 +2,15 @@
 
 #include <QDir>
 #include <QProcess>
+#include <QSaveFile>
 #include <algorithm>
 #include <fstream>
+#include <sstream>
 
+#include "dummyrpg/floor.hpp"
 #include "dummyrpg/serialize.hpp"
 #include "utils/logger.hpp"
+#include "utils/memoryStreamBuf.hpp"
 #include "widgetsMap/mapsTree.hpp"
 
 using std::make_shared;
@@ -73,6 +77,16 @@ MapsTreeModel* Project::mapsModel() const
     return m_mapsModel.get();
 }
 
+const TileAtlas& Project::tileAtlas() const
+{
+    return m_tileAtlas;
+}
+
+TileAtlas& Project::tileAtlas()
+{
+    return m_tileAtlas;
+}
+
 const Dummy::Map* Project::currMap() const
 {
     return m_currMap.get();
@@ -83,17 +97,38 @@ Dummy::Map* Project::currMap()
     return m_currMap.get();
 }
 
+std::shared_ptr<Dummy::Map> Project::sharedCurrMap() const
+{
+    return m_currMap;
+}
+
+const QString& Project::currMapName() const
+{
+    return m_currMapName;
+}
+
 bool Project::isModified() const
 {
-    return m_isModified;
+    return m_isTreeModified || m_isGameModified || m_isCurrMapModified;
 }
 
 void Project::changed()
 {
-    m_isModified = true;
+    m_isGameModified = true;
+    emit saveStatusChanged(false);
+}
+
+void Project::mapChanged()
+{
+    m_isCurrMapModified = true;
     emit saveStatusChanged(false);
 }
 
+void Project::updateSaveStatus()
+{
+    emit saveStatusChanged(! isModified());
+}
+
 void Project::testMap()
 {
     if (m_currMapName.isNull()) {
@@ -146,7 +181,31 @@ std::shared_ptr<Project> Project::create(const QString& projectRootPath)
     return std::make_shared<Project>(projectRootPath);
 }
 
-void Project::saveProject()
+bool Project::saveProject()
+{
+    bool bRes = true;
+    if (m_isTreeModified && ! saveTree()) {
+        Log::error("Error while saving the project file...");
+        bRes = false;
+    }
+
+    // Save opened map
+    if (m_isCurrMapModified && ! saveCurrMap()) {
+        Log::error("Error while saving the map...");
+        bRes = false;
+    }
+
+    // Save game file
+    if (m_isGameModified && ! saveGame()) {
+        Log::error("Error while saving the game data...");
+        bRes = false;
+    }
+
+    updateSaveStatus();
+    return bRes;
+}
+
+bool Project::saveTree()
 {
     QDomDocument doc;
     QDomElement projectNode = doc.createElement("project");
@@ -156,26 +215,23 @@ void Project::saveProject()
     projectNode.appendChild(mapsNode);
     dumpToXmlNode(doc, mapsNode, m_mapsModel->invisibleRootItem());
 
-    QFile file(m_projectPath + "/" + PROJECT_FILE_NAME);
-    file.open(QIODevice::WriteOnly | QIODevice::Text);
-    QTextStream stream(&file);
     const int indent = 4;
-    doc.save(stream, indent);
+    if (! writeFile(m_projectPath + "/" + PROJECT_FILE_NAME, doc.toByteArray(indent)))
+        return false;
 
-    // Save opened map
-    bool bRes = saveCurrMap();
-    if (bRes) {
-        m_isModified = false;
-        emit saveStatusChanged(true);
-    } else
-        Log::error("Error while saving the map...");
+    m_isTreeModified = false;
+    return true;
+}
 
-    // Save game file
+bool Project::saveGame()
+{
     m_game.cleanupUnused();
-    std::ofstream gameDataFile(m_projectPath.toStdString() + "/" + DATA_FILE_NAME, std::ios::binary);
-    bRes = Dummy::Serializer::serializeGameToFile(m_game, gameDataFile);
-    if (! bRes)
-        Log::error("Error while saving the game data...");
+    if (! writeGame(gameDataPath(), m_game))
+        return false;
+
+    m_isGameModified = false;
+    emit fileSaved(gameDataPath());
+    return true;
 }
 
 bool Project::saveCurrMap()
@@ -185,12 +241,45 @@ bool Project::saveCurrMap()
         return true;
     }
 
-    QString mapPath = m_projectPath + "/maps/" + m_currMapName + MAP_FILE_EXT;
-    auto tmp        = mapPath.toStdString();
-    std::ofstream mapDataFile(mapPath.toStdString(), std::ios::binary);
-    bool bRes = Dummy::Serializer::serializeMapToFile(*m_currMap, mapDataFile);
+    if (! writeMap(mapPath(m_currMapName), *m_currMap))
+        return false;
 
-    return bRes;
+    m_isCurrMapModified = false;
+    emit fileSaved(mapPath(m_currMapName));
+    return true;
+}
+
+bool Project::writeMap(const QString& path, const Dummy::Map& map)
+{
+    std::ostringstream mapData(std::ios::binary);
+    if (! Dummy::Serializer::serializeMapToFile(map, mapData))
+        return false;
+
+    const std::string bytes = mapData.str();
+    return writeFile(path, QByteArray::fromRawData(bytes.data(), static_cast<int>(bytes.size())));
+}
+
+bool Project::writeGame(const QString& path, const Dummy::GameStatic& game)
+{
+    std::ostringstream gameData(std::ios::binary);
+    if (! Dummy::Serializer::serializeGameToFile(game, gameData))
+        return false;
+
+    const std::string bytes = gameData.str();
+    return writeFile(path, QByteArray::fromRawData(bytes.data(), static_cast<int>(bytes.size())));
+}
+
+bool Project::writeFile(const QString& path, const QByteArray& data)
+{
+    // QSaveFile writes into a temporary file, only renamed over "path" on commit
+    QSaveFile file(path);
+    if (! file.open(QIODevice::WriteOnly))
+        return false;
+    if (file.write(data) != data.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
 }
 
 void Project::dumpToXmlNode(QDomDocument& doc, QDomElement& xmlNode, const QStandardItem* modelItem)
@@ -208,31 +297,36 @@ void Project::dumpToXmlNode(QDomDocument& doc, QDomElement& xmlNode, const QStan
     }
 }
 
-void Project::createMap(const tMapInfo& mapInfo, QStandardItem& parent)
+bool Project::createMap(const tMapInfo& mapInfo, QStandardItem& parent)
 {
     if (m_mapsModel == nullptr)
-        return;
+        return false;
 
     if (mapExists(QString::fromStdString(mapInfo.m_mapName)))
-        return;
+        return false;
+
+    if (! cacheCurrMap())
+        return false;
 
     const uint16_t w            = mapInfo.m_width;
     const uint16_t h            = mapInfo.m_height;
     const QString mapName       = sanitizeMapName(QString::fromStdString(mapInfo.m_mapName));
     const Dummy::char_id chipId = m_game.registerTileset(mapInfo.m_chispetPath);
 
-    if (m_currMap != nullptr)
-        saveCurrMap();
-
     m_currMap     = make_shared<Dummy::Map>(w, h, chipId);
     m_currMapName = mapName;
+    m_currChipsets.clear();
 
     // Add the new map into the tree.
     QList<QStandardItem*> mapRow {new QStandardItem(mapName)};
     parent.appendRow(mapRow);
     m_game.registerMap(mapName.toStdString());
 
+    m_isTreeModified    = true;
+    m_isGameModified    = true;
+    m_isCurrMapModified = true;
     saveProject();
+    return true;
 }
 
 bool Project::loadMap(const QString& mapName)
@@ -240,19 +334,173 @@ bool Project::loadMap(const QString& mapName)
     if (mapName == m_currMapName)
         return true;
 
-    if (m_currMap != nullptr)
-        saveCurrMap();
+    const tCachedMap cached = cachedMap(mapName);
+    if (cached.m_map != nullptr) {
+        return setCurrMap(mapName, cached.m_map, cached.m_chipsets);
+    }
 
-    m_currMap     = make_shared<Dummy::Map>();
-    m_currMapName = mapName;
+    auto map = readMap(mapPath(mapName));
+    if (map == nullptr) {
+        Log::error(QObject::tr("Error while loading the map %1").arg(mapPath(mapName)));
+        return false;
+    }
 
-    QString mapPath = m_projectPath + "/maps/" + mapName + MAP_FILE_EXT;
-    std::ifstream mapDataFile(mapPath.toStdString(), std::ios::binary);
-    bool bRes = Dummy::Serializer::parseMapFromFile(mapDataFile, *m_currMap);
-    if (! bRes)
-        Log::error(QObject::tr("Error while loading the map %1").arg(mapPath));
+    return setCurrMap(mapName, map);
+}
 
-    return bRes;
+bool Project::setCurrMap(const QString& mapName, std::shared_ptr<Dummy::Map> map, const std::vector<QImage>& chipsets)
+{
+    if (m_currMap != map) {
+        if (! cacheCurrMap())
+            return false; // its changes would be lost
+        m_isCurrMapModified = false;
+    }
+
+    // The current map can be modified, it doesn't stay in the cache
+    auto cached = std::find_if(m_mapCache.begin(), m_mapCache.end(),
+                               [&mapName](const tCachedMap& c) { return c.m_mapName == mapName; });
+    if (cached != m_mapCache.end()) {
+        m_mapCacheBytes -= cached->m_memoryUsage;
+        m_mapCache.erase(cached);
+    }
+
+    m_currMap      = map;
+    m_currMapName  = mapName;
+    m_currChipsets = chipsets;
+    updateSaveStatus();
+    return true;
+}
+
+tCachedMap Project::cachedMap(const QString& mapName) const
+{
+    for (const auto& cached : m_mapCache)
+        if (cached.m_mapName == mapName)
+            return cached;
+    return {};
+}
+
+bool Project::isMapCached(const QString& mapName) const
+{
+    return std::any_of(m_mapCache.begin(), m_mapCache.end(),
+                       [&mapName](const tCachedMap& c) { return c.m_mapName == mapName; });
+}
+
+void Project::forgetDecodedChipsets()
+{
+    m_currChipsets.clear();
+    for (auto& cached : m_mapCache) {
+        for (const auto& chipset : cached.m_chipsets) {
+            cached.m_memoryUsage -= static_cast<size_t>(chipset.sizeInBytes());
+            m_mapCacheBytes -= static_cast<size_t>(chipset.sizeInBytes());
+        }
+        cached.m_chipsets.clear();
+    }
+}
+
+static size_t mapMemoryUsage(const Dummy::Map& map, const std::vector<QImage>& chipsets)
+{
+    const size_t nbCells = static_cast<size_t>(map.width()) * map.height();
+    size_t bytes         = sizeof(Dummy::Map);
+    for (size_t i = 0; i < map.floors().size(); ++i) {
+        const auto* floor = map.floorAt(static_cast<uint8_t>(i));
+        if (floor != nullptr)
+            bytes += nbCells * (floor->graphicLayers().size() * sizeof(Dummy::Tileaspect) + sizeof(bool));
+    }
+    for (const auto& chipset : chipsets)
+        bytes += static_cast<size_t>(chipset.sizeInBytes());
+    return bytes;
+}
+
+bool Project::cacheCurrMap()
+{
+    if (m_currMap == nullptr)
+        return true;
+
+    // Cached maps are identical to their file: forgetting them never loses any change
+    if (m_isCurrMapModified && ! saveCurrMap()) {
+        Log::error(tr("Error while saving the map %1").arg(m_currMapName));
+        return false;
+    }
+
+    const size_t bytes = mapMemoryUsage(*m_currMap, m_currChipsets);
+    m_mapCache.push_front({m_currMapName, m_currMap, m_currChipsets, bytes});
+    m_mapCacheBytes += bytes;
+    fitMapCacheInBudget();
+    return true;
+}
+
+bool Project::cacheMap(const QString& mapName, std::shared_ptr<Dummy::Map> map, const std::vector<QImage>& chipsets)
+{
+    if (map == nullptr || mapName == m_currMapName || isMapCached(mapName))
+        return true;
+
+    // Maps loaded in advance never push out the maps actually used
+    const size_t bytes = mapMemoryUsage(*map, chipsets);
+    if (m_mapCacheBytes + bytes > MAP_CACHE_BUDGET)
+        return false;
+
+    m_mapCache.push_back({mapName, map, chipsets, bytes});
+    m_mapCacheBytes += bytes;
+    return true;
+}
+
+void Project::fitMapCacheInBudget()
+{
+    size_t nbForgotten = 0;
+    while (m_mapCacheBytes > MAP_CACHE_BUDGET && ! m_mapCache.empty()) {
+        m_mapCacheBytes -= m_mapCache.back().m_memoryUsage;
+        m_mapCache.pop_back();
+        ++nbForgotten;
+    }
+    if (nbForgotten > 0)
+        Log::debug(tr("Maps cache: %1 maps forgotten, %2 KB used").arg(nbForgotten).arg(m_mapCacheBytes / 1024));
+}
+
+std::shared_ptr<Dummy::Map> Project::readMap(const QString& filePath, eMapReading reading)
+{
+    auto map = make_shared<Dummy::Map>();
+
+    if (reading == eMapReading::Mapped) {
+        QFile file(filePath);
+        const qint64 size = file.size();
+        uchar* data       = (size > 0 && file.open(QIODevice::ReadOnly)) ? file.map(0, size) : nullptr;
+        if (data != nullptr) {
+            // The parser reads the pages of the file directly, they stay mapped as long as "file" lives
+            MemoryStreamBuf buffer(reinterpret_cast<const char*>(data), static_cast<size_t>(size));
+            std::istream mapData(&buffer);
+            if (! Dummy::Serializer::parseMapFromFile(mapData, *map))
+                return nullptr;
+
+            return map;
+        }
+        // Some files can't be mapped (ex: on some network drives), read them as a stream
+    }
+
+    std::ifstream mapDataFile(filePath.toStdString(), std::ios::binary);
+    if (! Dummy::Serializer::parseMapFromFile(mapDataFile, *map))
+        return nullptr;
+
+    return map;
+}
+
+QString Project::mapPath(const QString& mapName) const
+{
+    return m_projectPath + "/maps/" + mapName + MAP_FILE_EXT;
+}
+
+QString Project::gameDataPath() const
+{
+    return m_projectPath + "/" + DATA_FILE_NAME;
+}
+
+std::vector<QString> Project::chipsetPaths(const Dummy::Map& map) const
+{
+    std::vector<QString> chipsets;
+    for (Dummy::chip_id chipId : map.chipsetsUsed()) {
+        QString chipFile = QString::fromStdString(m_game.tileset(chipId));
+        chipsets.push_back(QDir::cleanPath(m_projectPath + "/images/" + chipFile));
+    }
+    return chipsets;
 }
 
 bool Project::mapExists(const QString& mapName)
@@ -277,15 +525,17 @@ bool Project::renameCurrMap(const QString& newName)
     m_game.renameMap(strOldName, strNewName);
 
     // Change in file name
-    QFile::rename(m_projectPath + "/maps/" + m_currMapName + MAP_FILE_EXT,
-                  m_projectPath + "/maps/" + newName + MAP_FILE_EXT);
+    QFile::rename(mapPath(m_currMapName), mapPath(newName));
 
     // Change in map architecture
     if (m_mapsModel)
         m_mapsModel->renameNode(m_currMapName, newName);
 
-    m_currMapName = newName;
-    m_isModified  = true;
+    // The map is saved again, under its new path
+    m_currMapName       = newName;
+    m_isTreeModified    = true;
+    m_isGameModified    = true;
+    m_isCurrMapModified = true;
     saveProject();
 
     return true;
@@ -0,0 +1,116 @@
+#include "editor/tileAtlas.hpp"
+
+#include <QPainter>
+
+#include "utils/atlasLayout.hpp"
+
+namespace Editor {
+
+static uint contentHash(const QPixmap& pixmap)
+{
+    const QImage image = pixmap.toImage();
+    return qHashBits(image.constBits(), static_cast<size_t>(image.sizeInBytes()));
+}
+
+bool TileAtlas::setChipset(Dummy::chip_id id, const QPixmap& chipset)
+{
+    const uint hash = contentHash(chipset);
+    if (id >= m_chipsets.size())
+        m_chipsets.resize(static_cast<size_t>(id) + 1);
+
+    tChipset& current = m_chipsets[id];
+    if (current.isSet && current.contentHash == hash && current.pixmap.size() == chipset.size())
+        return false; // reloaded, but nothing changed
+
+    // QPixmap is implicitly shared: this doesn't copy any pixel
+    current.pixmap      = chipset;
+    current.contentHash = hash;
+    current.isSet       = true;
+    m_isPacked          = false;
+    return true;
+}
+
+void TileAtlas::setMapChipsets(const std::vector<Dummy::chip_id>& chipsetIds)
+{
+    m_mapChipsets = chipsetIds;
+}
+
+bool TileAtlas::hasChipset(Dummy::chip_id id) const
+{
+    return id < m_chipsets.size() && m_chipsets[id].isSet;
+}
+
+tChipsetCells TileAtlas::chipsetCells(Dummy::chip_id id) const
+{
+    pack();
+    return hasChipset(id) ? m_chipsets[id].cells : tChipsetCells();
+}
+
+bool TileAtlas::hasSingleChipset() const
+{
+    return m_mapChipsets.size() == 1 && hasChipset(m_mapChipsets[0]);
+}
+
+Dummy::chip_id TileAtlas::singleChipset() const
+{
+    return m_mapChipsets.empty() ? Dummy::chip_id() : m_mapChipsets[0];
+}
+
+const QPixmap& TileAtlas::atlas() const
+{
+    pack();
+    return m_atlas;
+}
+
+QRect TileAtlas::tileSource(const Dummy::Tileaspect& aspect) const
+{
+    pack();
+    if (aspect == Dummy::undefAspect || ! hasChipset(aspect.chipId))
+        return QRect();
+
+    const tChipsetCells& cells = m_chipsets[aspect.chipId].cells;
+    if (! cells.contains(aspect))
+        return QRect();
+
+    return cells.source(aspect);
+}
+
+void TileAtlas::pack() const
+{
+    if (m_isPacked)
+        return;
+
+    // In id order, so that chipsets keep their place as long as no chipset is added before them
+    std::vector<Dummy::chip_id> ids;
+    std::vector<QSize> sizes;
+    for (size_t id = 0; id < m_chipsets.size(); ++id)
+        if (m_chipsets[id].isSet) {
+            ids.push_back(static_cast<Dummy::chip_id>(id));
+            sizes.push_back(m_chipsets[id].pixmap.size());
+        }
+    const tAtlasLayout layout = layoutAtlas(sizes);
+
+    m_atlas = QPixmap();
+    if (! layout.size.isEmpty()) {
+        m_atlas = QPixmap(layout.size);
+        m_atlas.fill(Qt::transparent);
+    }
+
+    QPainter painter;
+    if (! m_atlas.isNull()) {
+        painter.begin(&m_atlas);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const tChipset& chipset = m_chipsets[ids[i]];
+        chipset.cells.offset    = layout.rects[i].topLeft();
+        chipset.cells.width     = chipset.pixmap.width() / CELL_W;
+        chipset.cells.height    = chipset.pixmap.height() / CELL_H;
+        if (painter.isActive())
+            painter.drawPixmap(chipset.cells.offset, chipset.pixmap);
+    }
+
+    m_isPacked = true;
+}
+
+} // namespace Editor
@@ -3,6 +3,7 @@
 #include <QDateTime>
 #include <QDir>
 #include <iostream>
+#include <mutex>
 
 #include "dummyrpg/dummy_types.hpp"
 
@@ -26,19 +27,23 @@ void Dummy::LogErr(const std::string& msg)
 namespace Editor {
 
 std::vector<std::shared_ptr<Logger>> Logger::gLoggers;
+static std::recursive_mutex gLoggersMutex; // messages may come from worker threads
 
 void Logger::registerLogger(const std::shared_ptr<Logger>& toAdd)
 {
+    std::lock_guard<std::recursive_mutex> lock(gLoggersMutex);
     gLoggers.push_back(toAdd);
 }
 
 void Logger::unregisterLogger(const std::shared_ptr<Logger>& toRm)
 {
+    std::lock_guard<std::recursive_mutex> lock(gLoggersMutex);
     gLoggers.erase(std::remove(gLoggers.begin(), gLoggers.end(), toRm), gLoggers.end());
 }
 
 void Logger::printAll(const std::string& message, eLogType type)
 {
+    std::lock_guard<std::recursive_mutex> lock(gLoggersMutex);
     for (const auto& logger : Logger::gLoggers)
         if (logger != nullptr)
             logger->print(message, type);
@@ -45,7 +45,7 @@ CharacterInstanceWidget::~CharacterInstanceWidget() {}
 void CharacterInstanceWidget::on_btn_delete_clicked()
 {
     m_floor.deleteNpcAt(m_charInst.pos().coord);
-    m_loadedProject->changed();
+    m_loadedProject->mapChanged();
     this->reject();
 }
 
@@ -54,7 +54,7 @@ void CharacterInstanceWidget::on_choice_up_clicked()
     auto pos = m_charInst.pos();
     pos.dir  = Dummy::Direction::Top;
     m_charInst.setPos(pos);
-    m_loadedProject->changed();
+    m_loadedProject->mapChanged();
 }
 
 void CharacterInstanceWidget::on_choice_left_clicked()
@@ -62,7 +62,7 @@ void CharacterInstanceWidget::on_choice_left_clicked()
     auto pos = m_charInst.pos();
     pos.dir  = Dummy::Direction::Left;
     m_charInst.setPos(pos);
-    m_loadedProject->changed();
+    m_loadedProject->mapChanged();
 }
 
 void CharacterInstanceWidget::on_choice_right_clicked()
@@ -70,7 +70,7 @@ void CharacterInstanceWidget::on_choice_right_clicked()
     auto pos = m_charInst.pos();
     pos.dir  = Dummy::Direction::Right;
     m_charInst.setPos(pos);
-    m_loadedProject->changed();
+    m_loadedProject->mapChanged();
 }
 
 void CharacterInstanceWidget::on_choice_down_clicked()
@@ -78,13 +78,13 @@ void CharacterInstanceWidget::on_choice_down_clicked()
     auto pos = m_charInst.pos();
     pos.dir  = Dummy::Direction::Bottom;
     m_charInst.setPos(pos);
-    m_loadedProject->changed();
+    m_loadedProject->mapChanged();
 }
 
 void CharacterInstanceWidget::onEventChanged(Dummy::event_id id)
 {
     m_charInst.setEvent(id);
-    m_loadedProject->changed();
+    m_loadedProject->mapChanged();
 }
 
 } // namespace Editor
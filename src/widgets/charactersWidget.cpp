@@ -171,8 +171,10 @@ void CharactersWidget::on_btn_delete_clicked()
         return;
 
     auto* openedMap = m_loadedProject->currMap();
-    if (openedMap)
+    if (openedMap) {
         openedMap->unregisterCharacter(m_currCharacterId);
+        m_loadedProject->mapChanged();
+    }
 
     m_loadedProject->game().unregisterCharacter(m_currCharacterId);
 
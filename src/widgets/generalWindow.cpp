@@ -5,9 +5,15 @@
 #include <QDir>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QPixmapCache>
+#include <QScrollBar>
+#include <QTimer>
 
 #include "dummyrpg/floor.hpp"
 
+static const int LOADING_DIALOG_DELAY_MS = 300;       // quick loadings don't show a progress dialog
+static const int PIXMAP_CACHE_KB         = 64 * 1024; // mostly used by the caches of inactive floors
+
 namespace Editor {
 //////////////////////////////////////////////////////////////////////////////
 
@@ -22,6 +28,7 @@ GeneralWindow::GeneralWindow(QWidget* parent)
     m_ui->graphicsViewChipset->setScene(&m_chipsetScene);
     m_ui->graphicsViewChipset->scale(2.0, 2.0);
 
+    QPixmapCache::setCacheLimit(PIXMAP_CACHE_KB);
     m_ui->graphicsViewMap->setScene(&m_mapScene);
     m_ui->graphicsViewMap->setMouseTracking(true);
     m_ui->graphicsViewMap->scale(2.0, 2.0);
@@ -71,8 +78,19 @@ GeneralWindow::GeneralWindow(QWidget* parent)
     // connect ui items
     connect(m_ui->btnNewMap, &QPushButton::clicked, m_ui->mapsList, &MapsTreeView::addMapAtRoot);
     connect(m_ui->mapsList, &MapsTreeView::mapChanged, this, &GeneralWindow::loadMap);
+    connect(&m_mapLoader, &MapLoader::progressed, this, &GeneralWindow::mapLoadingProgressed);
+    connect(&m_mapLoader, &MapLoader::loaded, this, &GeneralWindow::mapLoaded);
+    connect(&m_mapLoader, &MapLoader::failed, this, &GeneralWindow::mapLoadingFailed);
     connect(&m_mapScene, &MapGraphicsScene::zooming, this, &GeneralWindow::mapZoomTriggered);
     connect(m_ui->tab_chars, &CharactersWidget::requestAddChar, this, &GeneralWindow::placeCharToScene);
+
+    // map content is instantiated when it gets visible
+    auto* mapView = m_ui->graphicsViewMap;
+    connect(mapView->horizontalScrollBar(), &QScrollBar::valueChanged, this, &GeneralWindow::revealVisibleMap);
+    connect(mapView->verticalScrollBar(), &QScrollBar::valueChanged, this, &GeneralWindow::revealVisibleMap);
+    connect(mapView->horizontalScrollBar(), &QScrollBar::rangeChanged, this, &GeneralWindow::revealVisibleMap);
+    connect(mapView->verticalScrollBar(), &QScrollBar::rangeChanged, this, &GeneralWindow::revealVisibleMap);
+    mapView->viewport()->installEventFilter(this);
 }
 
 GeneralWindow::~GeneralWindow()
@@ -92,8 +110,31 @@ void GeneralWindow::closeEvent(QCloseEvent* event)
         event->ignore();
 }
 
+bool GeneralWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_ui->graphicsViewMap->viewport() && event->type() == QEvent::Resize)
+        revealVisibleMap();
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
 bool GeneralWindow::loadProject(const QString& path)
 {
+    // An autosave remains if the editor was not closed properly
+    const QFileInfo pathInfo(QDir::cleanPath(path));
+    const QString projectDir = pathInfo.isDir() ? pathInfo.filePath() : pathInfo.path();
+    if (Autosaver::hasRecovery(projectDir)) {
+        auto answer = QMessageBox::question(this, "DummyEditor",
+                                            tr("This project has unsaved changes from a previous session. "
+                                               "Do you want to recover them?\n"
+                                               "The files they replace will be kept in %1")
+                                                .arg(QDir::toNativeSeparators(Autosaver::backupPath(projectDir))));
+        if (answer == QMessageBox::Yes)
+            Autosaver::restoreRecovery(projectDir);
+        else
+            Autosaver::removeRecovery(projectDir);
+    }
+
     auto newProject = std::make_shared<Project>(QDir::cleanPath(path));
 
     // Check if has been successfully loaded
@@ -103,7 +144,8 @@ bool GeneralWindow::loadProject(const QString& path)
     // Use this new project
     m_loadedProject = newProject;
     connect(m_loadedProject.get(), &Project::saveStatusChanged, this, &GeneralWindow::saveStatusChanged);
-    connect(&m_mapTools, &MapTools::modificationDone, m_loadedProject.get(), &Project::changed);
+    connect(&m_mapTools, &MapTools::modificationDone, m_loadedProject.get(), &Project::mapChanged);
+    m_autosaver.setProject(m_loadedProject);
 
     // Update the view
     updateProjectView();
@@ -124,13 +166,17 @@ bool GeneralWindow::closeProject()
         if (resBtn == QMessageBox::Yes) {
             m_loadedProject->saveProject();
         } else if (resBtn == QMessageBox::No) {
-            // Nothing to do
+            m_autosaver.discardRecovery();
         } else {
             return false; // failure of closing : cancellation
         }
     }
 
     // Clear project
+    m_mapLoader.cancel();
+    m_mapPrefetcher.cancel();
+    m_autosaver.setProject(nullptr);
+    m_loadingDialog.reset();
     m_loadedProject.reset();
 
     // Clear view
@@ -228,7 +274,8 @@ void GeneralWindow::on_actionNew_triggered()
         return;
 
     connect(m_loadedProject.get(), &Project::saveStatusChanged, this, &GeneralWindow::saveStatusChanged);
-    connect(&m_mapTools, &MapTools::modificationDone, m_loadedProject.get(), &Project::changed);
+    connect(&m_mapTools, &MapTools::modificationDone, m_loadedProject.get(), &Project::mapChanged);
+    m_autosaver.setProject(m_loadedProject);
     Log::info(tr("Project created at %1").arg(projectDirectory));
 
     // Update the view
@@ -259,11 +306,8 @@ void GeneralWindow::on_actionSave_triggered()
         return;
 
     // Save current project
-    m_loadedProject->saveProject();
-
-    // TODO: create a way to check the save action and get this info to
-    // condition the output info
-    Log::info(tr("Project saved"));
+    if (m_loadedProject->saveProject())
+        Log::info(tr("Project saved"));
 }
 
 void GeneralWindow::on_actionClose_triggered()
@@ -286,9 +330,65 @@ void GeneralWindow::on_mapsList_doubleClicked(const QModelIndex& selectedIndex)
 
 void GeneralWindow::loadMap(const QString& mapName)
 {
-    bool bRes = m_loadedProject->loadMap(mapName);
-    if (! bRes)
+    if (m_loadedProject == nullptr)
         return;
+
+    // The disk and workers are for this map first
+    m_mapPrefetcher.cancel();
+
+    // Current map is already in memory (and may have been modified, resized...), only refresh its view
+    if (mapName == m_loadedProject->currMapName() && m_loadedProject->currMap() != nullptr) {
+        m_mapLoader.cancel();
+        showCurrMap();
+        return;
+    }
+
+    // Recently used maps are still in memory
+    const tCachedMap cached = m_loadedProject->cachedMap(mapName);
+    if (cached.m_map != nullptr) {
+        m_mapLoader.cancel();
+        mapLoaded(mapName, cached.m_map, cached.m_chipsets);
+        return;
+    }
+
+    // Read and decode in background, the map is shown when "loaded" is received
+    m_loadingDialog = std::make_unique<QProgressDialog>(tr("Loading map %1...").arg(mapName), tr("Cancel"), 0,
+                                                        static_cast<int>(MapLoader::eStep::Done), this);
+    m_loadingDialog->setMinimumDuration(LOADING_DIALOG_DELAY_MS);
+    connect(m_loadingDialog.get(), &QProgressDialog::canceled, &m_mapLoader, &MapLoader::cancel);
+
+    m_mapLoader.load(m_loadedProject, mapName);
+}
+
+void GeneralWindow::mapLoadingProgressed(MapLoader::eStep step)
+{
+    if (m_loadingDialog != nullptr)
+        m_loadingDialog->setValue(static_cast<int>(step));
+}
+
+void GeneralWindow::mapLoaded(const QString& mapName, std::shared_ptr<Dummy::Map> map,
+                              const std::vector<QImage>& chipsets)
+{
+    if (m_loadedProject == nullptr)
+        return;
+
+    if (! m_loadedProject->setCurrMap(mapName, map, chipsets)) {
+        m_loadingDialog.reset();
+        QMessageBox::warning(this, "DummyEditor",
+                             tr("The map %1 couldn't be saved, it stays open so that its changes are not lost.")
+                                 .arg(m_loadedProject->currMapName()));
+        return;
+    }
+    showCurrMap(chipsets);
+}
+
+void GeneralWindow::mapLoadingFailed()
+{
+    m_loadingDialog.reset();
+}
+
+void GeneralWindow::showCurrMap(const std::vector<QImage>& decodedChipsets)
+{
     const auto* map = m_loadedProject->currMap();
     if (map == nullptr)
         return;
@@ -296,21 +396,50 @@ void GeneralWindow::loadMap(const QString& mapName)
     m_mapTools.clear();
 
     // update chipset scene
-    std::vector<QString> chipsets;
-    for (Dummy::chip_id chipId : map->chipsetsUsed()) {
-        QString chipFile = QString::fromStdString(m_loadedProject->game().tileset(chipId));
-        QString chipPath = QDir::cleanPath(m_loadedProject->projectPath() + "/images/" + chipFile);
-        chipsets.push_back(chipPath);
-    }
-
-    m_chipsetScene.setChipset(chipsets, map->chipsetsUsed());
+    m_chipsetScene.setChipset(m_loadedProject->chipsetPaths(*map), map->chipsetsUsed(), decodedChipsets);
     m_ui->chipsets_panel->setEnabled(true);
     m_ui->chipsetAddButton->setEnabled(false);
     m_ui->graphicsViewChipset->viewport()->update();
+    updateTileAtlas();
 
-    // update map scene
-    m_mapScene.setMap(m_loadedProject, *map, m_chipsetScene.chipsets());
+    // update map scene, floors are added one by one to keep the UI responsive
+    m_mapScene.setMap(m_loadedProject, m_loadedProject->sharedCurrMap());
     m_ui->graphicsViewMap->setSceneRect(QRect(0, 0, map->width() * CELL_W, map->height() * CELL_H));
+    if (m_loadingDialog != nullptr) {
+        m_loadingDialog->setCancelButton(nullptr); // the map is already loaded, too late to cancel
+        m_loadingDialog->setLabelText(tr("Building map view..."));
+        m_loadingDialog->setMaximum(static_cast<int>(map->floors().size()));
+        m_loadingDialog->setValue(0);
+    }
+
+    if (m_mapScene.hasFloorsToInstantiate())
+        instantiateNextFloor();
+    else
+        currMapShown();
+}
+
+void GeneralWindow::instantiateNextFloor()
+{
+    if (! m_mapScene.instantiateNextFloor())
+        return; // nothing left, the map view has already been finalized
+
+    revealVisibleMap();
+    if (m_loadingDialog != nullptr)
+        m_loadingDialog->setValue(m_loadingDialog->value() + 1);
+
+    if (m_mapScene.hasFloorsToInstantiate())
+        QTimer::singleShot(0, this, &GeneralWindow::instantiateNextFloor);
+    else
+        currMapShown();
+}
+
+void GeneralWindow::currMapShown()
+{
+    m_loadingDialog.reset();
+
+    const auto* map = m_loadedProject->currMap();
+    if (map == nullptr)
+        return;
 
     // update floor list
     m_ui->layer_list_tab->setEditorMap(*map);
@@ -322,6 +451,15 @@ void GeneralWindow::loadMap(const QString& mapName)
 
     // update layer list
     m_ui->maps_panel->setCurrentIndex(1);
+
+    // the user will likely open a neighbour map next
+    m_mapPrefetcher.prefetchAround(m_loadedProject, m_loadedProject->currMapName());
+}
+
+void GeneralWindow::revealVisibleMap()
+{
+    const auto* mapView = m_ui->graphicsViewMap;
+    m_mapScene.revealRegion(mapView->mapToScene(mapView->viewport()->rect()).boundingRect());
 }
 
 void GeneralWindow::placeCharToScene(Dummy::char_id id)
@@ -348,6 +486,7 @@ void GeneralWindow::addCharToFloor(Dummy::char_id id, Dummy::Coord coord, uint8_
 
     Dummy::PositionChar pos {coord, Dummy::Direction::Bottom, Dummy::CharState::Idle};
     floor->registerNPC(id, pos);
+    m_loadedProject->mapChanged();
 }
 
 void GeneralWindow::on_btn_refreshTileset_clicked()
@@ -357,7 +496,29 @@ void GeneralWindow::on_btn_refreshTileset_clicked()
         return;
 
     m_chipsetScene.refreshChipsets();
-    m_mapScene.updateTilesets(m_chipsetScene.chipsets(), map->chipsetsUsed());
+    m_loadedProject->forgetDecodedChipsets();
+
+    // Cells are never rebuilt: only repaint them if a chipset actually changed
+    if (updateTileAtlas())
+        m_mapScene.updateTilesets();
+}
+
+bool GeneralWindow::updateTileAtlas()
+{
+    const auto* map = m_loadedProject->currMap();
+    if (map == nullptr)
+        return false;
+
+    // The chipset scene already decoded the images, share them with the atlas
+    const auto& chipsetIds = map->chipsetsUsed();
+    const auto& chipsets   = m_chipsetScene.chipsets();
+    const size_t nbChips   = std::min(chipsetIds.size(), chipsets.size());
+    bool hasChanged        = false;
+    for (size_t i = 0; i < nbChips; ++i)
+        hasChanged |= m_loadedProject->tileAtlas().setChipset(chipsetIds[i], chipsets[i]);
+    m_loadedProject->tileAtlas().setMapChipsets(chipsetIds);
+
+    return hasChanged;
 }
 
 void GeneralWindow::on_toggleGridChipset_clicked(bool isDown)
@@ -389,6 +550,7 @@ void GeneralWindow::activeLayerChanged(eLayerType type, uint8_t floorIdx, uint8_
         m_ui->toolbar_mapTools->setEnabled(false);
     }
     m_mapScene.setCurrFloor(floorIdx);
+    revealVisibleMap();
 }
 
 void GeneralWindow::layerVisibilityChanged(bool newVisibility, eLayerType type, uint8_t floorIdx, uint8_t layerIdx)
@@ -403,6 +565,8 @@ void GeneralWindow::layerVisibilityChanged(bool newVisibility, eLayerType type,
             if (layerWrap->isThisFloor(floorIdx))
                 layerWrap->setVisibility(newVisibility);
     }
+    m_mapScene.refreshFloor(floorIdx);
+    revealVisibleMap();
 }
 
 void GeneralWindow::saveStatusChanged(bool saved)
@@ -428,6 +592,11 @@ void GeneralWindow::on_actionSelection_triggered()
     m_mapTools.setTool(MapTools::eTools::Selection);
 }
 
+void GeneralWindow::on_actionFreehand_toggled(bool freehand)
+{
+    m_mapTools.setFreehand(freehand);
+}
+
 void GeneralWindow::on_actionToggleGrid_triggered()
 {
     if (m_ui->panels_tabs->currentWidget() == m_ui->tab_map)
@@ -511,7 +680,9 @@ void LoggerStatusBar::print(const std::string& message, eLogType type)
     switch (type) {
     case eLogType::INFORMATION:
     case eLogType::ERROR:
-        m_statusBar->showMessage(QString::fromStdString(message));
+        // The status bar must only be touched from the GUI thread
+        QMetaObject::invokeMethod(m_statusBar, "showMessage", Qt::AutoConnection,
+                                  Q_ARG(QString, QString::fromStdString(message)), Q_ARG(int, 0));
         break;
     case eLogType::LOG:
     case eLogType::DEBUG:
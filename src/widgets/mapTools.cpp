@@ -1,10 +1,21 @@
 #include "widgets/mapTools.hpp"
 #include "ui_GeneralWindow.h"
 
+#include <QtMath>
+#include <algorithm>
+#include <cstdlib>
+
 #include "utils/definitions.hpp"
+#include "utils/logger.hpp"
 
 namespace Editor {
 
+// Rounded down, so that a point left of or above the map is out of it too
+static QPoint cellAt(const QPoint& pxCoord)
+{
+    return QPoint(qFloor(pxCoord.x() / static_cast<double>(CELL_W)), qFloor(pxCoord.y() / static_cast<double>(CELL_H)));
+}
+
 MapTools::MapTools(const ChipsetGraphicsScene& chipset, MapGraphicsScene& map, Ui::GeneralWindow& ui)
     : m_chipsetScene(chipset)
     , m_mapScene(map)
@@ -17,6 +28,7 @@ void MapTools::clear()
 {
     resetTools();
     resetLayerLink();
+    resetHistory();
     setTool(eTools::Pen);
 }
 
@@ -75,15 +87,22 @@ void MapTools::resetTools()
 
 void MapTools::resetLayerLink()
 {
+    // An interrupted stroke already painted its cells: it must still become a command
+    endStroke();
+
     m_currLayerType = eLayerType::None;
     m_visLayer      = nullptr;
     m_blockLayer    = nullptr;
+}
 
+void MapTools::resetHistory()
+{
     m_commandsHistory.clear();
-    m_toolsUI.actionUndo->setEnabled(false);
-    m_toolsUI.actionRedo->setEnabled(false);
     m_nbCommandsValid = 0;
+    m_historyBytes    = 0;
+    updateUndoRedoUI();
 }
+
 void MapTools::setTool(eTools tool)
 {
     resetTools();
@@ -137,6 +156,11 @@ QRect MapTools::adjustOnGrid(const QRect& rawRect)
     return QRect(p1, p2);
 }
 
+QRect MapTools::clipboardCells(const QPoint& pxCoord, uint16_t width, uint16_t height)
+{
+    return QRect(pxCoord.x() / CELL_W, pxCoord.y() / CELL_H, width, height);
+}
+
 void MapTools::forceInScene(QPoint& point)
 {
     int maxX = static_cast<int>(m_uiLayerW * m_uiGridStep) - 1;
@@ -153,28 +177,6 @@ void MapTools::forceInScene(QPoint& point)
         point.setY(maxY);
 }
 
-QPixmap MapTools::previewVisible(const QRect& region)
-{
-    const QPixmap chipsetSelection = m_chipsetScene.selectionPixmap();
-    if (chipsetSelection.isNull())
-        return QPixmap();
-
-    QPixmap previewImg(region.size());
-    QPainter painter(&previewImg);
-    const int rectW = region.width();
-    const int rectH = region.height();
-    const int dX    = static_cast<int>(chipsetSelection.width());
-    const int dY    = static_cast<int>(chipsetSelection.height());
-
-    for (int y = 0; y < rectH; y += dY) {
-        for (int x = 0; x < rectW; x += dX) {
-            painter.drawPixmap(QRect(x, y, dX, dY), chipsetSelection);
-        }
-    }
-
-    return previewImg;
-}
-
 void MapTools::drawVisible(const QRect& region)
 {
     if (m_currLayerType != eLayerType::Graphic || m_visLayer == nullptr)
@@ -202,7 +204,7 @@ void MapTools::drawVisible(const QRect& region)
             toDraw.content[index] = aspect;
         }
 
-    doCommand(std::make_unique<CommandPaint>(*this, region.topLeft(), std::move(toDraw)));
+    doCommand(std::make_unique<CommandPaint>(*this, *m_visLayer, region.topLeft(), std::move(toDraw)));
 }
 
 void MapTools::drawBlocking(const QRect& region)
@@ -214,7 +216,7 @@ void MapTools::drawBlocking(const QRect& region)
     toDraw.width  = static_cast<quint16>(region.width()) / CELL_H;
     toDraw.height = static_cast<quint16>(region.height()) / CELL_H;
     toDraw.content.resize(static_cast<size_t>(toDraw.width * toDraw.height), true);
-    doCommand(std::make_unique<CommandPaintBlocking>(*this, region.topLeft(), std::move(toDraw)));
+    doCommand(std::make_unique<CommandPaintBlocking>(*this, *m_blockLayer, region.topLeft(), std::move(toDraw)));
 }
 
 void MapTools::eraseVisible(const QRect& region)
@@ -227,7 +229,7 @@ void MapTools::eraseVisible(const QRect& region)
     toErase.height = static_cast<quint16>(region.height()) / CELL_H;
     toErase.content.resize(static_cast<size_t>(toErase.width * toErase.height), Dummy::undefAspect);
 
-    doCommand(std::make_unique<CommandPaint>(*this, region.topLeft(), std::move(toErase)));
+    doCommand(std::make_unique<CommandPaint>(*this, *m_visLayer, region.topLeft(), std::move(toErase)));
 }
 
 void MapTools::eraseBlocking(const QRect& region)
@@ -239,7 +241,7 @@ void MapTools::eraseBlocking(const QRect& region)
     toErase.width  = static_cast<quint16>(region.width()) / CELL_W;
     toErase.height = static_cast<quint16>(region.height()) / CELL_W;
     toErase.content.resize(static_cast<size_t>(toErase.width * toErase.height), false);
-    doCommand(std::make_unique<CommandPaintBlocking>(*this, region.topLeft(), std::move(toErase)));
+    doCommand(std::make_unique<CommandPaintBlocking>(*this, *m_blockLayer, region.topLeft(), std::move(toErase)));
 }
 void MapTools::copyCut(eCopyCut action)
 {
@@ -298,33 +300,34 @@ void MapTools::paste(const QPoint& point)
         if (m_visibleClipboard.width == 0 || m_visibleClipboard.height == 0)
             return;
 
-        doCommand(std::make_unique<CommandPaint>(*this, QPoint(point), tVisibleClipboard(m_visibleClipboard)));
+        doCommand(
+            std::make_unique<CommandPaint>(*this, *m_visLayer, QPoint(point), tVisibleClipboard(m_visibleClipboard)));
 
     } else if (m_currLayerType == eLayerType::Blocking && m_blockLayer != nullptr) {
         if (m_blockingClipboard.width == 0 || m_blockingClipboard.height == 0)
             return;
 
-        doCommand(
-            std::make_unique<CommandPaintBlocking>(*this, QPoint(point), tBlockingClipboard(m_blockingClipboard)));
+        doCommand(std::make_unique<CommandPaintBlocking>(*this, *m_blockLayer, QPoint(point),
+                                                         tBlockingClipboard(m_blockingClipboard)));
     }
 }
 
 void MapTools::previewTool(const QRect& clickingRegion)
 {
     QRect adjustedRegion = adjustOnGrid(clickingRegion);
-    QPixmap previewImg;
 
     switch (m_currMode) {
     case eTools::Pen:
 
         if (m_currLayerType == eLayerType::Graphic) {
-            previewImg = previewVisible(adjustedRegion);
+            const QPixmap& chipsetSelection = m_chipsetScene.selectionPixmap();
+            if (chipsetSelection.isNull())
+                m_mapScene.clearPreview();
+            else
+                m_mapScene.setPreview(adjustedRegion, chipsetSelection);
         } else if (m_currLayerType == eLayerType::Blocking) {
-            previewImg = QPixmap(adjustedRegion.size());
-            previewImg.fill(QColor(255, 0, 0, 50));
+            m_mapScene.setPreview(adjustedRegion, QColor(255, 0, 0, 50));
         }
-
-        m_mapScene.setPreview(previewImg, adjustedRegion.topLeft());
         break;
 
     case eTools::Eraser:
@@ -381,26 +384,172 @@ void MapTools::useTool(const QRect& clickingRegion)
     }
 }
 
+void MapTools::setFreehand(bool freehand)
+{
+    m_isFreehand = freehand;
+}
+
+bool MapTools::beginStroke(const QPoint& pxCoord)
+{
+    if (! m_isFreehand || (m_currMode != eTools::Pen && m_currMode != eTools::Eraser))
+        return false;
+
+    if (m_currLayerType == eLayerType::Graphic) {
+        if (m_visLayer == nullptr || (m_currMode == eTools::Pen && m_chipsetScene.selectionRect().isNull()))
+            return false;
+    } else if (m_currLayerType != eLayerType::Blocking || m_blockLayer == nullptr) {
+        return false;
+    }
+
+    // assign() and clear() keep the capacity of the previous strokes
+    m_stroke.touched.assign(static_cast<size_t>(m_uiLayerW * m_uiLayerH), false);
+    m_stroke.visibleBefore.clear();
+    m_stroke.blockingBefore.clear();
+    m_stroke.bounds   = QRect();
+    m_stroke.lastCell = cellAt(pxCoord);
+    m_stroke.isActive = true;
+
+    strokeAt(m_stroke.lastCell);
+    return true;
+}
+
+void MapTools::continueStroke(const QPoint& pxCoord)
+{
+    if (! m_stroke.isActive)
+        return;
+
+    const QPoint cell = cellAt(pxCoord);
+    if (cell == m_stroke.lastCell)
+        return;
+
+    // Mouse events can skip cells on fast moves: paint the whole segment since the last one
+    const QPoint delta = cell - m_stroke.lastCell;
+    const int nbSteps  = std::max(std::abs(delta.x()), std::abs(delta.y()));
+    for (int i = 1; i <= nbSteps; ++i)
+        strokeAt(m_stroke.lastCell + QPoint(qRound(delta.x() * i / static_cast<double>(nbSteps)),
+                                            qRound(delta.y() * i / static_cast<double>(nbSteps))));
+
+    m_stroke.lastCell = cell;
+}
+
+void MapTools::strokeAt(const QPoint& cell)
+{
+    if (m_currLayerType == eLayerType::Blocking) {
+        if (cell.x() >= 0 && cell.y() >= 0 && cell.x() < m_uiLayerW && cell.y() < m_uiLayerH)
+            strokeCell({static_cast<uint16_t>(cell.x()), static_cast<uint16_t>(cell.y())}, m_currMode == eTools::Pen);
+        return;
+    }
+
+    // The eraser clears a single cell
+    if (m_currMode == eTools::Eraser) {
+        if (cell.x() >= 0 && cell.y() >= 0 && cell.x() < m_uiLayerW && cell.y() < m_uiLayerH)
+            strokeCell({static_cast<uint16_t>(cell.x()), static_cast<uint16_t>(cell.y())}, Dummy::undefAspect);
+        return;
+    }
+
+    // The pen stamps the chipset selection, its pattern is aligned on the map so that a stroke looks seamless
+    const QRect& selection = m_chipsetScene.selectionRect();
+    const int selX         = selection.x() / CELL_W;
+    const int selY         = selection.y() / CELL_H;
+    const int selW         = std::max(selection.width() / CELL_W, 1);
+    const int selH         = std::max(selection.height() / CELL_H, 1);
+    const int maxX         = std::min(cell.x() + selW, static_cast<int>(m_uiLayerW));
+    const int maxY         = std::min(cell.y() + selH, static_cast<int>(m_uiLayerH));
+
+    for (int y = std::max(cell.y(), 0); y < maxY; ++y)
+        for (int x = std::max(cell.x(), 0); x < maxX; ++x) {
+            Dummy::Tileaspect aspect {static_cast<uint8_t>(selX + x % selW), static_cast<uint8_t>(selY + y % selH),
+                                      m_chipsetScene.currId()};
+            strokeCell({static_cast<uint16_t>(x), static_cast<uint16_t>(y)}, aspect);
+        }
+}
+
+void MapTools::strokeCell(Dummy::Coord coord, const Dummy::Tileaspect& aspect)
+{
+    // Remember the value from before the stroke, the first time a cell is painted
+    const uint32_t index = static_cast<uint32_t>(coord.y * m_uiLayerW + coord.x);
+    if (! m_stroke.touched[index]) {
+        m_stroke.touched[index] = true;
+        m_stroke.visibleBefore.emplace_back(index, m_visLayer->layer().at(coord));
+        m_stroke.bounds |= QRect(coord.x, coord.y, 1, 1);
+    }
+
+    // Only marks a part of a chunk as dirty: the scene repaints all of them at once, on the next frame
+    m_visLayer->setTile(coord, aspect);
+}
+
+void MapTools::strokeCell(Dummy::Coord coord, bool isBlocking)
+{
+    const uint32_t index = static_cast<uint32_t>(coord.y * m_uiLayerW + coord.x);
+    if (! m_stroke.touched[index]) {
+        m_stroke.touched[index] = true;
+        m_stroke.blockingBefore.emplace_back(index, m_blockLayer->layer().at(coord) != 0);
+        m_stroke.bounds |= QRect(coord.x, coord.y, 1, 1);
+    }
+
+    m_blockLayer->setTile(coord, isBlocking);
+}
+
+// Delta of a whole stroke, from the current values of the cells and the values they had before the stroke
+template <typename T>
+static TilesDelta<T> strokeDelta(const QRect& cells, uint16_t layerW, const std::vector<T>& after,
+                                 const std::vector<std::pair<uint32_t, T>>& cellsBefore)
+{
+    std::vector<T> before = after;
+    for (const auto& cellBefore : cellsBefore) {
+        const int x = static_cast<int>(cellBefore.first % layerW);
+        const int y = static_cast<int>(cellBefore.first / layerW);
+        before[static_cast<size_t>((y - cells.top()) * cells.width() + (x - cells.left()))] = cellBefore.second;
+    }
+
+    TilesDelta<T> delta;
+    delta.compute(before, after);
+    return delta;
+}
+
+void MapTools::endStroke()
+{
+    if (! m_stroke.isActive)
+        return;
+
+    m_stroke.isActive  = false;
+    const QRect& cells = m_stroke.bounds;
+    if (cells.isEmpty())
+        return;
+
+    // The cells are already painted, the command only remembers the stroke for undo/redo
+    if (m_currLayerType == eLayerType::Graphic && m_visLayer != nullptr) {
+        auto delta = strokeDelta(cells, m_uiLayerW, m_visLayer->tiles(cells), m_stroke.visibleBefore);
+        if (! delta.isEmpty())
+            doCommand(std::make_unique<CommandPaint>(*this, *m_visLayer, cells, std::move(delta)), true);
+
+    } else if (m_currLayerType == eLayerType::Blocking && m_blockLayer != nullptr) {
+        auto delta = strokeDelta(cells, m_uiLayerW, m_blockLayer->tiles(cells), m_stroke.blockingBefore);
+        if (! delta.isEmpty())
+            doCommand(std::make_unique<CommandPaintBlocking>(*this, *m_blockLayer, cells, std::move(delta)), true);
+    }
+}
 
 // Commands history
 
-void MapTools::doCommand(std::unique_ptr<Command>&& c)
+void MapTools::doCommand(std::unique_ptr<Command>&& c, bool isExecuted)
 {
-    c->execute();
+    if (! isExecuted)
+        c->execute();
 
-    // Here we don't consider overflow of a max of commands to remember because the commands history is reset each time
-    // the active layer is changed.
+    // Forget the commands that were undone, they cannot be redone anymore
     auto& histo = m_commandsHistory; // alias
-
+    for (size_t i = m_nbCommandsValid; i < histo.size(); ++i)
+        m_historyBytes -= histo[i]->memoryUsage();
     if (m_nbCommandsValid < histo.size())
         histo.erase(histo.begin() + static_cast<long>(m_nbCommandsValid), histo.end());
 
+    m_historyBytes += c->memoryUsage();
     histo.push_back(std::move(c));
     ++m_nbCommandsValid;
+    fitHistoryInBudget();
 
-    // update UI
-    m_toolsUI.actionUndo->setEnabled(true);
-    m_toolsUI.actionRedo->setEnabled(false);
+    updateUndoRedoUI();
     emit modificationDone();
 }
 
@@ -412,9 +561,7 @@ void MapTools::undo()
     m_commandsHistory[m_nbCommandsValid - 1]->undo();
     --m_nbCommandsValid;
 
-    // update UI
-    m_toolsUI.actionUndo->setEnabled(m_nbCommandsValid > 0);
-    m_toolsUI.actionRedo->setEnabled(true);
+    updateUndoRedoUI();
     emit modificationDone();
 }
 
@@ -426,93 +573,141 @@ void MapTools::redo()
     ++m_nbCommandsValid;
     m_commandsHistory[m_nbCommandsValid - 1]->execute();
 
-    // update UI
-    m_toolsUI.actionUndo->setEnabled(true);
-    m_toolsUI.actionRedo->setEnabled(m_nbCommandsValid < m_commandsHistory.size());
+    updateUndoRedoUI();
     emit modificationDone();
 }
 
-MapTools::CommandPaint::CommandPaint(MapTools& parent, QPoint&& pxCoord, tVisibleClipboard&& clip)
+void MapTools::fitHistoryInBudget()
+{
+    // The last command is always kept, even if it's bigger than the budget alone
+    size_t nbForgotten = 0;
+    while (m_historyBytes > HISTORY_BUDGET && nbForgotten + 1 < m_nbCommandsValid) {
+        m_historyBytes -= m_commandsHistory[nbForgotten]->memoryUsage();
+        ++nbForgotten;
+    }
+    if (nbForgotten == 0)
+        return;
+
+    m_commandsHistory.erase(m_commandsHistory.begin(), m_commandsHistory.begin() + static_cast<long>(nbForgotten));
+    m_nbCommandsValid -= nbForgotten;
+    Log::debug(
+        tr("Undo history: %1 oldest commands forgotten, %2 KB used").arg(nbForgotten).arg(m_historyBytes / 1024));
+}
+
+void MapTools::updateUndoRedoUI()
+{
+    m_toolsUI.actionUndo->setEnabled(m_nbCommandsValid > 0);
+    m_toolsUI.actionRedo->setEnabled(m_nbCommandsValid < m_commandsHistory.size());
+    m_toolsUI.actionUndo->setToolTip(tr("Undo (history: %1 KB)").arg(m_historyBytes / 1024));
+}
+
+MapTools::CommandPaint::CommandPaint(MapTools& parent, const LayerGraphicItems& layer, QPoint&& pxCoord,
+                                     tVisibleClipboard&& clip)
     : m_parent(parent)
-    , m_position(std::move(pxCoord))
+    , m_floorIdx(layer.floorIdx())
+    , m_layerIdx(layer.layerIdx())
+    , m_cells(clipboardCells(pxCoord, clip.width, clip.height))
     , m_toDraw(std::move(clip))
 {}
 
+MapTools::CommandPaint::CommandPaint(MapTools& parent, const LayerGraphicItems& layer, const QRect& cells,
+                                     TilesDelta<Dummy::Tileaspect>&& done)
+    : m_parent(parent)
+    , m_floorIdx(layer.floorIdx())
+    , m_layerIdx(layer.layerIdx())
+    , m_cells(cells)
+    , m_delta(std::move(done))
+{}
+
 void MapTools::CommandPaint::execute()
 {
-    m_replacedTiles = m_toDraw;
-
-    if (m_parent.m_currLayerType != eLayerType::Graphic || m_parent.m_visLayer == nullptr)
+    // The layer is found again each time: it doesn't have to be the active one
+    LayerGraphicItems* layer = m_parent.m_mapScene.graphicLayer(m_floorIdx, m_layerIdx);
+    if (layer == nullptr)
         return;
 
-    uint16_t minX = static_cast<uint16_t>(m_position.x()) / CELL_W;
-    uint16_t minY = static_cast<uint16_t>(m_position.y()) / CELL_H;
-    for (uint16_t y = minY; y < (m_toDraw.height + minY) && y < m_parent.m_uiLayerH; ++y) {
-        for (uint16_t x = minX; x < (m_toDraw.width + minX) && x < m_parent.m_uiLayerW; ++x) {
-            size_t idxInClipboard                   = (y - minY) * m_toDraw.width + (x - minX);
-            m_replacedTiles.content[idxInClipboard] = m_parent.m_visLayer->layer().at({x, y});
+    auto values = layer->tiles(m_cells);
 
-            auto newValue = m_toDraw.content[idxInClipboard];
-            m_parent.m_visLayer->setTile({x, y}, newValue);
-        }
+    // First execution: only remember what really changed, and forget the clipboard
+    if (! m_toDraw.content.empty()) {
+        layer->setTiles(m_cells, m_toDraw.content);
+        m_delta.compute(values, layer->tiles(m_cells));
+        m_toDraw = tVisibleClipboard();
+    } else {
+        m_delta.applyAfter(values);
+        layer->setTiles(m_cells, values);
     }
+    m_parent.m_mapScene.refreshFloor(m_floorIdx);
 }
 
 void MapTools::CommandPaint::undo()
 {
-    if (m_parent.m_currLayerType != eLayerType::Graphic || m_parent.m_visLayer == nullptr)
+    LayerGraphicItems* layer = m_parent.m_mapScene.graphicLayer(m_floorIdx, m_layerIdx);
+    if (layer == nullptr)
         return;
 
-    uint16_t minX = static_cast<uint16_t>(m_position.x()) / CELL_W;
-    uint16_t minY = static_cast<uint16_t>(m_position.y()) / CELL_H;
-    for (uint16_t y = minY; y < (m_toDraw.height + minY) && y < m_parent.m_uiLayerH; ++y) {
-        for (uint16_t x = minX; x < (m_toDraw.width + minX) && x < m_parent.m_uiLayerW; ++x) {
-            size_t idxInClipboard = (y - minY) * m_toDraw.width + (x - minX);
-            auto newValue         = m_replacedTiles.content[idxInClipboard];
-            m_parent.m_visLayer->setTile({x, y}, newValue);
-        }
-    }
+    auto values = layer->tiles(m_cells);
+    m_delta.applyBefore(values);
+    layer->setTiles(m_cells, values);
+    m_parent.m_mapScene.refreshFloor(m_floorIdx);
 }
 
-MapTools::CommandPaintBlocking::CommandPaintBlocking(MapTools& parent, QPoint&& pxCoord, tBlockingClipboard&& clip)
+size_t MapTools::CommandPaint::memoryUsage() const
+{
+    return sizeof(*this) + m_delta.memoryUsage() + m_toDraw.content.capacity() * sizeof(Dummy::Tileaspect);
+}
+
+MapTools::CommandPaintBlocking::CommandPaintBlocking(MapTools& parent, const LayerBlockingItems& layer,
+                                                     QPoint&& pxCoord, tBlockingClipboard&& clip)
     : m_parent(parent)
-    , m_position(std::move(pxCoord))
+    , m_floorIdx(layer.floorIdx())
+    , m_cells(clipboardCells(pxCoord, clip.width, clip.height))
     , m_toDraw(std::move(clip))
 {}
 
+MapTools::CommandPaintBlocking::CommandPaintBlocking(MapTools& parent, const LayerBlockingItems& layer,
+                                                     const QRect& cells, TilesDelta<bool>&& done)
+    : m_parent(parent)
+    , m_floorIdx(layer.floorIdx())
+    , m_cells(cells)
+    , m_delta(std::move(done))
+{}
+
 void MapTools::CommandPaintBlocking::execute()
 {
-    m_replacedTiles = m_toDraw;
-
-    if (m_parent.m_currLayerType != eLayerType::Blocking || m_parent.m_blockLayer == nullptr)
+    // The layer is found again each time: it doesn't have to be the active one
+    LayerBlockingItems* layer = m_parent.m_mapScene.blockingLayer(m_floorIdx);
+    if (layer == nullptr)
         return;
 
-    uint16_t minX = static_cast<uint16_t>(m_position.x()) / CELL_W;
-    uint16_t minY = static_cast<uint16_t>(m_position.y()) / CELL_H;
-    for (uint16_t y = minY; y < (m_toDraw.height + minY) && y < m_parent.m_uiLayerH; ++y) {
-        for (uint16_t x = minX; x < (m_toDraw.width + minX) && x < m_parent.m_uiLayerW; ++x) {
-            size_t idxInClipboard                   = (y - minY) * m_toDraw.width + (x - minX);
-            m_replacedTiles.content[idxInClipboard] = m_parent.m_blockLayer->layer().at({x, y});
+    auto values = layer->tiles(m_cells);
 
-            auto newValue = m_toDraw.content[idxInClipboard];
-            m_parent.m_blockLayer->setTile({x, y}, newValue);
-        }
+    // First execution: only remember what really changed, and forget the clipboard
+    if (! m_toDraw.content.empty()) {
+        layer->setTiles(m_cells, m_toDraw.content);
+        m_delta.compute(values, layer->tiles(m_cells));
+        m_toDraw = tBlockingClipboard();
+    } else {
+        m_delta.applyAfter(values);
+        layer->setTiles(m_cells, values);
     }
+    m_parent.m_mapScene.refreshFloor(m_floorIdx);
 }
 
 void MapTools::CommandPaintBlocking::undo()
 {
-    if (m_parent.m_currLayerType != eLayerType::Blocking || m_parent.m_blockLayer == nullptr)
+    LayerBlockingItems* layer = m_parent.m_mapScene.blockingLayer(m_floorIdx);
+    if (layer == nullptr)
         return;
 
-    uint16_t minX = static_cast<uint16_t>(m_position.x()) / CELL_W;
-    uint16_t minY = static_cast<uint16_t>(m_position.y()) / CELL_H;
-    for (uint16_t y = minY; y < (m_toDraw.height + minY) && y < m_parent.m_uiLayerH; ++y) {
-        for (uint16_t x = minX; x < (m_toDraw.width + minX) && x < m_parent.m_uiLayerW; ++x) {
-            size_t idxInClipboard = (y - minY) * m_toDraw.width + (x - minX);
-            auto newValue         = m_replacedTiles.content[idxInClipboard];
-            m_parent.m_blockLayer->setTile({x, y}, newValue);
-        }
-    }
+    auto values = layer->tiles(m_cells);
+    m_delta.applyBefore(values);
+    layer->setTiles(m_cells, values);
+    m_parent.m_mapScene.refreshFloor(m_floorIdx);
+}
+
+size_t MapTools::CommandPaintBlocking::memoryUsage() const
+{
+    return sizeof(*this) + m_delta.memoryUsage() + m_toDraw.content.capacity() / 8;
 }
 } // namespace Editor
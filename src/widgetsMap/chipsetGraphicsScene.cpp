@@ -1,7 +1,10 @@
 #include "widgetsMap/chipsetGraphicsScene.hpp"
 
 #include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <algorithm>
 
+#include "utils/atlasLayout.hpp"
 #include "utils/definitions.hpp"
 
 ChipsetGraphicsScene::ChipsetGraphicsScene(QObject* parent)
@@ -15,17 +18,20 @@ void ChipsetGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent* mouseEvent)
     if (! mouseEvent->buttons().testFlag(Qt::LeftButton) || m_isSelecting)
         return;
 
-    m_isSelecting    = true;
-    m_selectionStart = mouseEvent->scenePos().toPoint();
+    // A selection is always inside a single chipset of the palette
+    const QPoint pt       = mouseEvent->scenePos().toPoint();
+    const size_t nbChips  = std::min(m_chipRects.size(), m_chipIds.size());
+    size_t clickedChipIdx = nbChips;
+    for (size_t i = 0; i < nbChips; ++i)
+        if (m_chipRects[i].contains(pt))
+            clickedChipIdx = i;
+    if (clickedChipIdx == nbChips)
+        return;
 
-    if (m_selectionStart.x() >= m_chipset.width())
-        m_selectionStart.setX(m_chipset.width() - 1);
-    if (m_selectionStart.x() < 0)
-        m_selectionStart.setX(0);
-    if (m_selectionStart.y() >= m_chipset.height())
-        m_selectionStart.setY(m_chipset.height() - 1);
-    if (m_selectionStart.y() < 0)
-        m_selectionStart.setY(0);
+    m_isSelecting    = true;
+    m_currId         = m_chipIds[clickedChipIdx];
+    m_currChipRect   = m_chipRects[clickedChipIdx];
+    m_selectionStart = pt;
 
     // Add a square
     int x = m_selectionStart.x() - (m_selectionStart.x() % CELL_W);
@@ -38,15 +44,9 @@ void ChipsetGraphicsScene::mouseMoveEvent(QGraphicsSceneMouseEvent* mouseEvent)
     if (! m_isSelecting)
         return;
 
-    QPoint pt = mouseEvent->scenePos().toPoint();
-    if (pt.x() >= m_chipset.width())
-        pt.setX(m_chipset.width() - 1);
-    if (m_selectionStart.x() < 0)
-        pt.setX(0);
-    if (pt.y() >= m_chipset.height())
-        pt.setY(m_chipset.height() - 1);
-    if (pt.y() < 0)
-        pt.setY(0);
+    const QPoint mousePt = mouseEvent->scenePos().toPoint();
+    const QPoint pt(std::clamp(mousePt.x(), m_currChipRect.left(), m_currChipRect.right()),
+                    std::clamp(mousePt.y(), m_currChipRect.top(), m_currChipRect.bottom()));
 
     // normalize selection rectangle in order accept any direction of selection
     QRect realRect = QRect(m_selectionStart, pt).normalized();
@@ -65,18 +65,19 @@ void ChipsetGraphicsScene::mouseReleaseEvent(QGraphicsSceneMouseEvent*)
     m_isSelecting = false;
 }
 
-QPixmap ChipsetGraphicsScene::selectionPixmap() const
+const QPixmap& ChipsetGraphicsScene::selectionPixmap() const
 {
-    if (m_currentSelection.isNull())
-        return QPixmap();
+    // Previews ask for it on each mouse move: only copy it once per selection
+    if (m_selectionPixmap.isNull() && ! m_currentSelection.isNull())
+        m_selectionPixmap = m_palette.copy(m_currentSelection.translated(m_currChipRect.topLeft()));
 
-    return m_chipset.copy(m_currentSelection);
+    return m_selectionPixmap;
 }
 
 void ChipsetGraphicsScene::clear()
 {
     m_selectionRectItem.reset();
-    m_gridItems.clear();
+    m_gridItem.reset();
     QGraphicsScene::clear();
 }
 
@@ -85,7 +86,7 @@ void ChipsetGraphicsScene::setGridVisible(bool visible)
     if (visible)
         drawGrid();
     else
-        m_gridItems.clear();
+        m_gridItem.reset();
 }
 
 void ChipsetGraphicsScene::setDarkBackground(bool dark)
@@ -102,50 +103,64 @@ void ChipsetGraphicsScene::refreshChipsets()
 }
 
 void ChipsetGraphicsScene::setChipset(const std::vector<QString>& chipsetPaths,
-                                      const std::vector<Dummy::chip_id>& chipsetIds)
+                                      const std::vector<Dummy::chip_id>& chipsetIds,
+                                      const std::vector<QImage>& decodedChipsets)
 {
     clear();
 
-    // TODO handle several chipsets
     m_chipPaths = chipsetPaths;
     m_chipIds   = chipsetIds;
 
-    m_chipset = QPixmap(chipsetPaths[0]);
-    m_currId  = chipsetIds[0];
-    addPixmap(m_chipset);
+    // Images may have been decoded in advance (by a worker thread)
+    m_chipsets.clear();
+    std::vector<QSize> sizes;
+    for (size_t i = 0; i < chipsetPaths.size(); ++i) {
+        if (i < decodedChipsets.size())
+            m_chipsets.push_back(QPixmap::fromImage(decodedChipsets[i]));
+        else
+            m_chipsets.emplace_back(chipsetPaths[i]);
+        sizes.push_back(m_chipsets.back().size());
+    }
+
+    // All the chipsets of the map are shown in a single palette
+    const Editor::tAtlasLayout layout = Editor::layoutAtlas(sizes);
+    m_chipRects                       = layout.rects;
+    m_palette                         = QPixmap(layout.size);
+    if (! m_palette.isNull()) {
+        m_palette.fill(Qt::transparent);
+        QPainter painter(&m_palette);
+        for (size_t i = 0; i < m_chipsets.size(); ++i)
+            painter.drawPixmap(m_chipRects[i].topLeft(), m_chipsets[i]);
+    }
+
+    m_currId       = chipsetIds.empty() ? 0 : chipsetIds[0];
+    m_currChipRect = m_chipRects.empty() ? QRect() : m_chipRects[0];
+    addPixmap(m_palette);
     setSelectRect(QRect(0, 0, 0, 0));
     drawGrid();
 }
 
 void ChipsetGraphicsScene::drawGrid()
 {
-    m_gridItems.clear();
-
-    QPen pen(Qt::black, 0.5);
-
-    int chipW = m_chipset.width();
-    for (int x = 0; x <= chipW; x += CELL_W) {
-        QGraphicsItem* item = addLine(x, 0, x, m_chipset.height(), pen);
-        item->setZValue(Z_GRID);
-        m_gridItems.push_back(std::unique_ptr<QGraphicsItem>(item));
+    if (m_gridItem == nullptr) {
+        m_gridItem = std::make_unique<Editor::GridItem>(QPen(Qt::black, 0.5));
+        addItem(m_gridItem.get());
     }
 
-    int chipH = m_chipset.height();
-    for (int y = 0; y <= chipH; y += CELL_H) {
-        QGraphicsItem* item = addLine(0, y, m_chipset.width(), y, pen);
-        item->setZValue(Z_GRID);
-        m_gridItems.push_back(std::unique_ptr<QGraphicsItem>(item));
-    }
+    m_gridItem->setGrid(m_palette.size(), QSize(CELL_W, CELL_H));
 }
 
 void ChipsetGraphicsScene::setSelectRect(const QRect& rect)
 {
-    m_currentSelection = rect;
-
-    m_selectionRectItem = std::make_unique<QGraphicsRectItem>(rect);
-    QBrush brush(QColor(66, 135, 245));
-    m_selectionRectItem->setBrush(brush);
-    m_selectionRectItem->setOpacity(0.5);
-    addItem(m_selectionRectItem.get());
-    update();
+    m_currentSelection = rect.translated(-m_currChipRect.topLeft());
+    m_selectionPixmap  = QPixmap();
+
+    // A single item is kept: moving it only repaints its old and new areas
+    if (m_selectionRectItem == nullptr) {
+        m_selectionRectItem = std::make_unique<QGraphicsRectItem>();
+        m_selectionRectItem->setBrush(QBrush(QColor(66, 135, 245)));
+        m_selectionRectItem->setOpacity(0.5);
+        addItem(m_selectionRectItem.get());
+    }
+    m_selectionRectItem->setRect(rect);
 }
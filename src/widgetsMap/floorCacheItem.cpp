@@ -0,0 +1,92 @@
+#include "widgetsMap/floorCacheItem.hpp"
+
+#include <QPainter>
+#include <QPixmapCache>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+
+#include "utils/definitions.hpp"
+#include "widgetsMap/layerItems.hpp"
+
+namespace Editor {
+
+static uint64_t nextCacheId()
+{
+    static uint64_t nextId = 0;
+    return ++nextId;
+}
+
+FloorCacheItem::FloorCacheItem(uint16_t floorW, uint16_t floorH)
+    : m_cacheId(nextCacheId())
+    , m_floorW(floorW)
+    , m_floorH(floorH)
+{
+    // we need the exposed rect to only paint the chunks that need it
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+void FloorCacheItem::addLayer(const MapSceneLayer& layer)
+{
+    m_layers.push_back(&layer);
+    update();
+}
+
+QRectF FloorCacheItem::boundingRect() const
+{
+    return QRectF(0, 0, m_floorW * CELL_W, m_floorH * CELL_H);
+}
+
+void FloorCacheItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    const QRectF exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty())
+        return;
+
+    const int chunkW    = CHUNK_SIZE * CELL_W;
+    const int chunkH    = CHUNK_SIZE * CELL_H;
+    const int minChunkX = static_cast<int>(exposed.left()) / chunkW;
+    const int minChunkY = static_cast<int>(exposed.top()) / chunkH;
+    const int maxChunkX = static_cast<int>(exposed.right()) / chunkW;
+    const int maxChunkY = static_cast<int>(exposed.bottom()) / chunkH;
+
+    for (int chunkY = minChunkY; chunkY <= maxChunkY; ++chunkY)
+        for (int chunkX = minChunkX; chunkX <= maxChunkX; ++chunkX) {
+            QRect cells(chunkX * CHUNK_SIZE, chunkY * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE);
+            cells = cells.intersected(QRect(0, 0, m_floorW, m_floorH));
+            if (! cells.isEmpty())
+                painter->drawPixmap(cells.x() * CELL_W, cells.y() * CELL_H, chunkPixmap(cells));
+        }
+}
+
+uint64_t FloorCacheItem::revision() const
+{
+    uint64_t rev = 0;
+    for (const auto* layer : m_layers)
+        rev = std::max(rev, layer->revision());
+    return rev;
+}
+
+QPixmap FloorCacheItem::chunkPixmap(const QRect& cells) const
+{
+    // Outdated pixmaps are never hit again, the cache evicts them when it needs room
+    const QString key = QString("floor%1_%2_%3_%4").arg(m_cacheId).arg(revision()).arg(cells.x()).arg(cells.y());
+
+    QPixmap pixmap;
+    if (QPixmapCache::find(key, &pixmap))
+        return pixmap;
+
+    pixmap = QPixmap(cells.width() * CELL_W, cells.height() * CELL_H);
+    pixmap.fill(Qt::transparent);
+    {
+        QPainter painter(&pixmap);
+        painter.translate(-cells.x() * CELL_W, -cells.y() * CELL_H);
+        for (const auto* layer : m_layers)
+            if (layer->isVisible())
+                layer->paintCells(painter, cells);
+    }
+
+    QPixmapCache::insert(key, pixmap);
+    return pixmap;
+}
+
+} // namespace Editor
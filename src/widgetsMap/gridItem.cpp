@@ -0,0 +1,70 @@
+#include "widgetsMap/gridItem.hpp"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVector>
+#include <algorithm>
+
+#include "utils/definitions.hpp"
+
+static const qreal MIN_CELL_ON_SCREEN = 4.; // in screen pixels, under this size the grid is hidden
+
+namespace Editor {
+
+GridItem::GridItem(const QPen& pen)
+    : m_pen(pen)
+{
+    // we need the exposed rect to only paint the lines that need it
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    setZValue(Z_GRID);
+}
+
+void GridItem::setGrid(const QSize& sizePx, const QSize& cellSizePx)
+{
+    if (sizePx == m_size && cellSizePx == m_cellSize)
+        return;
+
+    prepareGeometryChange();
+    m_size     = sizePx;
+    m_cellSize = cellSizePx;
+}
+
+QRectF GridItem::boundingRect() const
+{
+    // Lines on the borders are drawn with a pen: keep a small margin for them
+    const qreal margin = m_pen.widthF();
+    return QRectF(QPointF(0, 0), QSizeF(m_size)).adjusted(-margin, -margin, margin, margin);
+}
+
+void GridItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    if (m_cellSize.width() <= 0 || m_cellSize.height() <= 0)
+        return;
+
+    const qreal zoom = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    if (std::min(m_cellSize.width(), m_cellSize.height()) * zoom < MIN_CELL_ON_SCREEN)
+        return;
+
+    const QRectF exposed = option->exposedRect.intersected(QRectF(QPointF(0, 0), QSizeF(m_size)));
+    if (exposed.isEmpty())
+        return;
+
+    const int cellW = m_cellSize.width();
+    const int cellH = m_cellSize.height();
+    const int minX  = std::max(static_cast<int>(exposed.left()) / cellW, 0);
+    const int maxX  = std::min(static_cast<int>(exposed.right()) / cellW + 1, m_size.width() / cellW);
+    const int minY  = std::max(static_cast<int>(exposed.top()) / cellH, 0);
+    const int maxY  = std::min(static_cast<int>(exposed.bottom()) / cellH + 1, m_size.height() / cellH);
+
+    QVector<QLineF> lines;
+    lines.reserve((maxX - minX + 1) + (maxY - minY + 1));
+    for (int x = minX; x <= maxX; ++x)
+        lines.push_back(QLineF(x * cellW, exposed.top(), x * cellW, exposed.bottom()));
+    for (int y = minY; y <= maxY; ++y)
+        lines.push_back(QLineF(exposed.left(), y * cellH, exposed.right(), y * cellH));
+
+    painter->setPen(m_pen);
+    painter->drawLines(lines);
+}
+
+} // namespace Editor
@@ -0,0 +1,43 @@
+#include "widgetsMap/layerContainerItem.hpp"
+
+namespace Editor {
+
+LayerContainerItem::LayerContainerItem()
+{
+    // Only the children are drawn
+    setFlag(QGraphicsItem::ItemHasNoContents);
+}
+
+void LayerContainerItem::setSize(const QSize& sizePx)
+{
+    if (sizePx == m_size)
+        return;
+
+    prepareGeometryChange();
+    m_size = sizePx;
+}
+
+void LayerContainerItem::addChild(QGraphicsItem* item)
+{
+    item->setParentItem(this);
+}
+
+void LayerContainerItem::clearChildren()
+{
+    // Removing the last child is cheap, so children are deleted from the last one
+    const QList<QGraphicsItem*> children = childItems();
+    for (auto it = children.crbegin(); it != children.crend(); ++it)
+        delete *it;
+}
+
+QRectF LayerContainerItem::boundingRect() const
+{
+    return QRectF(QPointF(0, 0), QSizeF(m_size));
+}
+
+void LayerContainerItem::paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*)
+{
+    // Nothing to paint, see ItemHasNoContents
+}
+
+} // namespace Editor
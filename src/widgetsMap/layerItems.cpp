@@ -1,11 +1,41 @@
 #include "widgetsMap/layerItems.hpp"
 
 #include <QGraphicsItem>
+#include <QPainter>
+#include <algorithm>
 
 #include "widgetsMap/graphicItem.hpp"
+#include "widgetsMap/tileChunkItem.hpp"
 
 namespace Editor {
 
+// Most maps use a single chipset: its cells are resolved once for the whole
+// region, and each cell is then a comparison and a bit of arithmetic
+template <bool isSingleChipset>
+static void appendFragments(const Dummy::GraphicLayer& layer, const TileAtlas& atlas, const QRect& region,
+                            QVector<QPainter::PixmapFragment>& fragments)
+{
+    const Dummy::chip_id singleId   = atlas.singleChipset();
+    const tChipsetCells singleCells = isSingleChipset ? atlas.chipsetCells(singleId) : tChipsetCells();
+
+    for (int y = region.top(); y <= region.bottom(); ++y)
+        for (int x = region.left(); x <= region.right(); ++x) {
+            const Dummy::Tileaspect& aspect = layer.at({static_cast<uint16_t>(x), static_cast<uint16_t>(y)});
+            QRect source;
+            if (isSingleChipset && aspect.chipId == singleId && ! (aspect == Dummy::undefAspect)) {
+                if (! singleCells.contains(aspect))
+                    continue;
+                source = singleCells.source(aspect);
+            } else {
+                source = atlas.tileSource(aspect); // other chipsets are still drawn
+                if (source.isNull())
+                    continue;
+            }
+            fragments.append(QPainter::PixmapFragment::create(
+                QPointF(x * CELL_W + CELL_W / 2., y * CELL_H + CELL_H / 2.), source));
+        }
+}
+
 MapSceneLayer::MapSceneLayer(uint8_t floorIdx, uint8_t layerIdx, int zIndex)
     : m_floorIdx(floorIdx)
     , m_layerIdx(layerIdx)
@@ -15,15 +45,61 @@ MapSceneLayer::MapSceneLayer(uint8_t floorIdx, uint8_t layerIdx, int zIndex)
 
 void MapSceneLayer::clear()
 {
-    for (auto* item : m_items->childItems())
-        m_items->removeFromGroup(item);
-
+    m_items->clearChildren();
     m_indexedItems.clear();
 }
 
 void MapSceneLayer::setVisibility(bool visible)
 {
+    if (visible == m_isVisible)
+        return;
+
+    // Hidden layers don't keep any item, they will be revealed again when shown
+    m_isVisible = visible;
     m_items->setVisible(visible);
+    if (! visible)
+        releaseChunks();
+    touch();
+}
+
+int MapSceneLayer::zIndex() const
+{
+    return static_cast<int>(m_items->zValue());
+}
+
+void MapSceneLayer::setCollapsed(bool collapsed)
+{
+    if (collapsed == m_isCollapsed)
+        return;
+
+    m_isCollapsed = collapsed;
+    if (collapsed)
+        releaseChunks();
+}
+
+void MapSceneLayer::paintCells(QPainter&, const QRect&) const
+{
+    // Nothing to paint by default
+}
+
+void MapSceneLayer::touch()
+{
+    // Revisions are unique among all the layers: a group of layers can use the max of its revisions as its own
+    static uint64_t nextRevision = 0;
+    m_revision                   = ++nextRevision;
+}
+
+void MapSceneLayer::releaseChunks()
+{
+    m_items->clearChildren();
+    std::fill(m_indexedItems.begin(), m_indexedItems.end(), nullptr);
+    std::fill(m_builtChunks.begin(), m_builtChunks.end(), false);
+    chunksReleased();
+}
+
+void MapSceneLayer::chunksReleased()
+{
+    // Nothing else to release by default
 }
 
 bool MapSceneLayer::isThisFloor(uint8_t floorIdx) const
@@ -36,67 +112,144 @@ bool MapSceneLayer::isThisLayer(uint8_t floorIdx, uint8_t layerIdx) const
     return (m_floorIdx == floorIdx) && (m_layerIdx == layerIdx);
 }
 
+void MapSceneLayer::reveal(const QRect& cellsRegion)
+{
+    if (! m_isVisible || m_isCollapsed)
+        return;
+
+    const QRect region = cellsRegion.intersected(QRect(0, 0, m_layerW, m_layerH));
+    if (region.isEmpty())
+        return;
+
+    const int minChunkX = region.left() / CHUNK_SIZE;
+    const int minChunkY = region.top() / CHUNK_SIZE;
+    const int maxChunkX = std::min(region.right() / CHUNK_SIZE, m_nbChunksW - 1);
+    const int maxChunkY = std::min(region.bottom() / CHUNK_SIZE, m_nbChunksH - 1);
+
+    for (int chunkY = minChunkY; chunkY <= maxChunkY; ++chunkY)
+        for (int chunkX = minChunkX; chunkX <= maxChunkX; ++chunkX) {
+            size_t chunkIdx = static_cast<size_t>(chunkY * m_nbChunksW + chunkX);
+            if (m_builtChunks[chunkIdx])
+                continue;
+
+            QRect cells(chunkX * CHUNK_SIZE, chunkY * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE);
+            buildChunk(chunkIdx, cells.intersected(QRect(0, 0, m_layerW, m_layerH)));
+            m_builtChunks[chunkIdx] = true;
+        }
+}
+
+void MapSceneLayer::setSize(uint16_t layerW, uint16_t layerH)
+{
+    m_layerW = layerW;
+    m_layerH = layerH;
+    m_items->setSize(QSize(layerW * CELL_W, layerH * CELL_H));
+}
+
+void MapSceneLayer::setupChunks(uint16_t layerW, uint16_t layerH)
+{
+    setSize(layerW, layerH);
+    m_nbChunksW = static_cast<uint16_t>((layerW + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    m_nbChunksH = static_cast<uint16_t>((layerH + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    m_builtChunks.assign(static_cast<size_t>(m_nbChunksW * m_nbChunksH), false);
+}
+
+size_t MapSceneLayer::chunkIndex(Dummy::Coord coord) const
+{
+    return static_cast<size_t>((coord.y / CHUNK_SIZE) * m_nbChunksW + (coord.x / CHUNK_SIZE));
+}
+
+bool MapSceneLayer::isChunkBuilt(Dummy::Coord coord) const
+{
+    size_t chunkIdx = chunkIndex(coord);
+    return chunkIdx < m_builtChunks.size() && m_builtChunks[chunkIdx];
+}
+
+void MapSceneLayer::buildChunk(size_t, const QRect&)
+{
+    // Nothing to build by default
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
-LayerGraphicItems::LayerGraphicItems(Dummy::GraphicLayer& layer, const std::vector<QPixmap>& chipsets,
-                                     const std::vector<Dummy::chip_id>& chipsetIds, uint8_t floorIdx, uint8_t layerIdx,
-                                     int zIndex)
+LayerGraphicItems::LayerGraphicItems(Dummy::GraphicLayer& layer, const TileAtlas& atlas, uint8_t floorIdx,
+                                     uint8_t layerIdx, int zIndex)
     : MapSceneLayer(floorIdx, layerIdx, zIndex)
     , m_graphicLayer(layer)
-    , m_chipsets(chipsets)
-    , m_chipsetIds(chipsetIds)
-{
-    const size_t nbCells = layer.size();
-    indexedItems().resize(nbCells);
-
-    uint16_t w = m_graphicLayer.width();
-    uint16_t h = m_graphicLayer.height();
-    for (uint16_t x = 0; x < w; ++x)
-        for (uint16_t y = 0; y < h; ++y) {
-            Dummy::Coord coord {x, y};
-            setTile(coord, m_graphicLayer.at(coord));
-        }
+    , m_atlas(atlas)
+{
+    setupChunks(m_graphicLayer.width(), m_graphicLayer.height());
+    m_chunks.resize(nbChunks(), nullptr);
+}
+
+void LayerGraphicItems::buildChunk(size_t chunkIdx, const QRect& cells)
+{
+    auto* chunk = new TileChunkItem(*this, cells);
+    graphicItems()->addChild(chunk);
+    m_chunks[chunkIdx] = chunk;
+}
+
+void LayerGraphicItems::chunksReleased()
+{
+    std::fill(m_chunks.begin(), m_chunks.end(), nullptr);
 }
 
 void LayerGraphicItems::setTile(Dummy::Coord coord, Dummy::Tileaspect aspect)
 {
-    if (coord.x > m_graphicLayer.width() || coord.y > m_graphicLayer.height())
+    if (coord.x >= m_graphicLayer.width() || coord.y >= m_graphicLayer.height())
         return;
 
-    size_t index = (coord.y * m_graphicLayer.width()) + coord.x;
+    m_graphicLayer.set(coord, validAspect(aspect));
+    touch();
 
-    if (nullptr != indexedItems()[index]) {
-        delete indexedItems()[index];
-        indexedItems()[index] = nullptr;
-    }
+    // Only the chunk containing this cell needs to be redrawn
+    TileChunkItem* chunk = chunkAt(coord);
+    if (chunk != nullptr)
+        chunk->invalidateCell(coord);
+}
 
-    size_t idxOfChip = idxOfId(aspect.chipId);
-    if (aspect == Dummy::undefAspect || idxOfChip >= m_chipsets.size()) {
-        m_graphicLayer.set(coord, Dummy::undefAspect);
-    } else {
-        const QPixmap& chip = m_chipsets[idxOfChip];
-        indexedItems()[index] =
-            new QGraphicsPixmapItem(chip.copy(QRect(aspect.x * CELL_W, aspect.y * CELL_H, CELL_W, CELL_H)));
-        indexedItems()[index]->setPos(coord.x * CELL_W, coord.y * CELL_H);
-        graphicItems()->addToGroup(indexedItems()[index]);
+void LayerGraphicItems::setTiles(const QRect& cells, const std::vector<Dummy::Tileaspect>& values)
+{
+    const QRect region = cells.intersected(layerRect());
+    if (region.isEmpty() || values.size() < static_cast<size_t>(cells.width() * cells.height()))
+        return;
 
-        m_graphicLayer.set(coord, aspect);
-    }
+    // Update the whole model first...
+    for (int y = region.top(); y <= region.bottom(); ++y)
+        for (int x = region.left(); x <= region.right(); ++x) {
+            const size_t idxInValues = static_cast<size_t>((y - cells.top()) * cells.width() + (x - cells.left()));
+            m_graphicLayer.set({static_cast<uint16_t>(x), static_cast<uint16_t>(y)}, validAspect(values[idxInValues]));
+        }
+    touch();
+
+    // ... then ask a single repaint per chunk touched
+    const QRectF regionPx(region.x() * CELL_W, region.y() * CELL_H, region.width() * CELL_W, region.height() * CELL_H);
+    for (auto* chunk : m_chunks)
+        if (chunk != nullptr && chunk->cells().intersects(region))
+            chunk->update(regionPx);
 }
 
-void LayerGraphicItems::updateTilesets(const std::vector<QPixmap>& chipsets,
-                                       const std::vector<Dummy::chip_id>& chipsetIds)
+std::vector<Dummy::Tileaspect> LayerGraphicItems::tiles(const QRect& cells) const
 {
-    m_chipsets   = chipsets;
-    m_chipsetIds = chipsetIds;
+    std::vector<Dummy::Tileaspect> values(static_cast<size_t>(cells.width() * cells.height()), Dummy::undefAspect);
 
-    uint16_t w = m_graphicLayer.width();
-    uint16_t h = m_graphicLayer.height();
-    for (uint16_t x = 0; x < w; ++x)
-        for (uint16_t y = 0; y < h; ++y) {
-            Dummy::Coord coord {x, y};
-            setTile(coord, m_graphicLayer.at(coord));
+    const QRect region = cells.intersected(layerRect());
+    for (int y = region.top(); y <= region.bottom(); ++y)
+        for (int x = region.left(); x <= region.right(); ++x) {
+            const size_t idxInValues = static_cast<size_t>((y - cells.top()) * cells.width() + (x - cells.left()));
+            values[idxInValues]      = m_graphicLayer.at({static_cast<uint16_t>(x), static_cast<uint16_t>(y)});
         }
+
+    return values;
+}
+
+void LayerGraphicItems::updateTilesets()
+{
+    touch();
+
+    // Cells are read from the atlas at paint time, a repaint is enough
+    for (auto* chunk : m_chunks)
+        if (chunk != nullptr)
+            chunk->update();
 }
 
 const Dummy::GraphicLayer& LayerGraphicItems::layer()
@@ -104,37 +257,87 @@ const Dummy::GraphicLayer& LayerGraphicItems::layer()
     return m_graphicLayer;
 }
 
-size_t LayerGraphicItems::idxOfId(Dummy::chip_id id)
+void LayerGraphicItems::paintCells(QPainter& painter, const QRect& cellsRegion) const
+{
+    const int minX = std::max(cellsRegion.left(), 0);
+    const int minY = std::max(cellsRegion.top(), 0);
+    const int maxX = std::min(cellsRegion.right(), m_graphicLayer.width() - 1);
+    const int maxY = std::min(cellsRegion.bottom(), m_graphicLayer.height() - 1);
+    if (maxX < minX || maxY < minY)
+        return;
+
+    // All tiles come from the atlas: the whole region is drawn in one call
+    QVector<QPainter::PixmapFragment> fragments;
+    fragments.reserve((maxX - minX + 1) * (maxY - minY + 1));
+    const QRect region(QPoint(minX, minY), QPoint(maxX, maxY));
+    if (m_atlas.hasSingleChipset())
+        appendFragments<true>(m_graphicLayer, m_atlas, region, fragments);
+    else
+        appendFragments<false>(m_graphicLayer, m_atlas, region, fragments);
+
+    if (! fragments.isEmpty())
+        painter.drawPixmapFragments(fragments.constData(), fragments.size(), m_atlas.atlas());
+}
+
+Dummy::Tileaspect LayerGraphicItems::validAspect(const Dummy::Tileaspect& aspect) const
+{
+    if (aspect == Dummy::undefAspect || ! m_atlas.hasChipset(aspect.chipId))
+        return Dummy::undefAspect;
+
+    return aspect;
+}
+
+TileChunkItem* LayerGraphicItems::chunkAt(Dummy::Coord coord) const
 {
-    const size_t nbOfChips = m_chipsetIds.size();
-    for (size_t i = 0; i < nbOfChips; ++i)
-        if (id == m_chipsetIds[i])
-            return i;
+    size_t index = chunkIndex(coord);
+    if (index >= m_chunks.size())
+        return nullptr;
 
-    return static_cast<size_t>(-1);
+    return m_chunks[index]; // nullptr if not revealed yet
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-LayerBlockingItems::LayerBlockingItems(Dummy::BlockingLayer& layer, uint8_t floorIdx, uint8_t layerIdx, int zIndex)
+LayerBlockingItems::LayerBlockingItems(Dummy::BlockingLayer& layer, uint8_t floorIdx, uint8_t layerIdx, int zIndex,
+                                       QImage mask)
     : MapSceneLayer(floorIdx, layerIdx, zIndex)
     , m_blockingLayer(layer)
+    , m_mask(mask.size() == QSize(layer.width(), layer.height()) ? mask : buildMask(layer))
 {
-    const size_t nbCells = layer.size();
-    indexedItems().resize(nbCells);
+    setupChunks(layer.width(), layer.height());
+}
 
-    uint16_t w = layer.width();
-    uint16_t h = layer.height();
+QImage LayerBlockingItems::buildMask(const Dummy::BlockingLayer& layer)
+{
+    QImage mask(layer.width(), layer.height(), QImage::Format_Mono);
+    mask.setColorTable({qRgba(0, 0, 0, 0), qRgba(255, 0, 0, 100)});
+    mask.fill(0);
+    for (uint16_t y = 0; y < layer.height(); ++y)
+        for (uint16_t x = 0; x < layer.width(); ++x)
+            if (layer.at({x, y}) != 0)
+                setMaskBit(mask, {x, y}, true);
+
+    return mask;
+}
 
-    for (uint16_t x = 0; x < w; ++x)
-        for (uint16_t y = 0; y < h; ++y)
-            if (m_blockingLayer.at({x, y}) != 0)
-                setTile({x, y}, true);
+void LayerBlockingItems::buildChunk(size_t, const QRect&)
+{
+    // A single item draws the whole mask, it is built with the first chunk revealed
+    if (m_maskItem != nullptr)
+        return;
+
+    m_maskItem = new TileChunkItem(*this, layerRect());
+    graphicItems()->addChild(m_maskItem);
+}
+
+void LayerBlockingItems::chunksReleased()
+{
+    m_maskItem = nullptr;
 }
 
 void LayerBlockingItems::toogleTile(Dummy::Coord coord)
 {
-    if (coord.x > m_blockingLayer.width() || coord.y > m_blockingLayer.height())
+    if (coord.x >= m_blockingLayer.width() || coord.y >= m_blockingLayer.height())
         return;
 
     if (m_blockingLayer.at(coord) != 0) {
@@ -146,23 +349,66 @@ void LayerBlockingItems::toogleTile(Dummy::Coord coord)
 
 void LayerBlockingItems::setTile(Dummy::Coord coord, bool isBlock)
 {
-    if (coord.x > m_blockingLayer.width() || coord.y > m_blockingLayer.height())
+    if (coord.x >= m_blockingLayer.width() || coord.y >= m_blockingLayer.height())
         return;
 
-    size_t index((coord.y * m_blockingLayer.width()) + coord.x);
+    m_blockingLayer.set(coord, isBlock);
+    setMaskBit(m_mask, coord, isBlock);
+    touch();
 
-    if (indexedItems()[index] != nullptr) {
-        delete indexedItems()[index];
-        indexedItems()[index] = nullptr;
-    }
+    if (m_maskItem != nullptr)
+        m_maskItem->invalidateCell(coord);
+}
 
-    if (isBlock) {
-        indexedItems()[index] = new GraphicItem(GraphicItem::eGraphicItemType::BlockingSquare);
-        indexedItems()[index]->setPos(QPointF(coord.x * CELL_W, coord.y * CELL_H));
-        graphicItems()->addToGroup(indexedItems()[index]);
-    }
+void LayerBlockingItems::setTiles(const QRect& cells, const std::vector<bool>& values)
+{
+    const QRect region = cells.intersected(layerRect());
+    if (region.isEmpty() || values.size() < static_cast<size_t>(cells.width() * cells.height()))
+        return;
 
-    m_blockingLayer.set(coord, isBlock);
+    for (int y = region.top(); y <= region.bottom(); ++y)
+        for (int x = region.left(); x <= region.right(); ++x) {
+            const size_t idxInValues = static_cast<size_t>((y - cells.top()) * cells.width() + (x - cells.left()));
+            const Dummy::Coord coord {static_cast<uint16_t>(x), static_cast<uint16_t>(y)};
+            m_blockingLayer.set(coord, values[idxInValues]);
+            setMaskBit(m_mask, coord, values[idxInValues]);
+        }
+    touch();
+
+    invalidateCells(region);
+}
+
+std::vector<bool> LayerBlockingItems::tiles(const QRect& cells) const
+{
+    std::vector<bool> values(static_cast<size_t>(cells.width() * cells.height()), false);
+
+    const QRect region = cells.intersected(layerRect());
+    for (int y = region.top(); y <= region.bottom(); ++y)
+        for (int x = region.left(); x <= region.right(); ++x) {
+            const size_t idxInValues = static_cast<size_t>((y - cells.top()) * cells.width() + (x - cells.left()));
+            values[idxInValues]      = m_blockingLayer.at({static_cast<uint16_t>(x), static_cast<uint16_t>(y)}) != 0;
+        }
+
+    return values;
+}
+
+void LayerBlockingItems::setMaskBit(QImage& mask, Dummy::Coord coord, bool isBlock)
+{
+    // Format_Mono: 8 cells per byte, the most significant bit first
+    uchar* line         = mask.scanLine(coord.y);
+    const uchar cellBit = static_cast<uchar>(0x80 >> (coord.x & 7));
+    if (isBlock)
+        line[coord.x >> 3] |= cellBit;
+    else
+        line[coord.x >> 3] &= static_cast<uchar>(~cellBit);
+}
+
+void LayerBlockingItems::invalidateCells(const QRect& cells)
+{
+    if (m_maskItem == nullptr)
+        return;
+
+    m_maskItem->update(QRectF(cells.x() * CELL_W, cells.y() * CELL_H, cells.width() * CELL_W, cells.height() * CELL_H));
 }
 
 const Dummy::BlockingLayer& LayerBlockingItems::layer()
@@ -170,12 +416,24 @@ const Dummy::BlockingLayer& LayerBlockingItems::layer()
     return m_blockingLayer;
 }
 
+void LayerBlockingItems::paintCells(QPainter& painter, const QRect& cellsRegion) const
+{
+    const QRect region = cellsRegion.intersected(layerRect());
+    if (region.isEmpty())
+        return;
+
+    // Each bit of the mask is scaled to a whole cell
+    const QRect target(region.x() * CELL_W, region.y() * CELL_H, region.width() * CELL_W, region.height() * CELL_H);
+    painter.drawImage(target, m_mask, region);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 LayerObjectItems::LayerObjectItems(Dummy::Floor& floor, int zIndex)
     : MapSceneLayer(0, 0, zIndex)
     , m_floor(floor)
 {
+    setSize(floor.blockingLayer().width(), floor.blockingLayer().height());
     update();
 }
 
@@ -191,7 +449,7 @@ void LayerObjectItems::addChar(Dummy::char_id, const Dummy::Coord& coord)
 {
     indexedItems().push_back(new GraphicItem(GraphicItem::eGraphicItemType::Character));
     indexedItems().back()->setPos(QPointF(coord.x * CELL_W, coord.y * CELL_H));
-    graphicItems()->addToGroup(indexedItems().back());
+    graphicItems()->addChild(indexedItems().back());
 }
 
 Dummy::Floor& LayerObjectItems::floor()
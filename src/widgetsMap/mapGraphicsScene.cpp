@@ -1,17 +1,29 @@
 #include "widgetsMap/mapGraphicsScene.hpp"
 
 #include <QGraphicsSceneMouseEvent>
+#include <QtConcurrent>
 
 #include "dummyrpg/floor.hpp"
 #include "utils/definitions.hpp"
 #include "widgets/characterInstanceWidget.hpp"
 #include "widgets/mapTools.hpp"
 
+static const int PREVIEW_INTERVAL_MS = 16; // previews are refreshed at most ~60 times per second
+
 namespace Editor {
 
+static QImage buildBlockingMask(const std::shared_ptr<const Dummy::BlockingLayer>& layer)
+{
+    return LayerBlockingItems::buildMask(*layer);
+}
+
 MapGraphicsScene::MapGraphicsScene(QObject* parent)
     : QGraphicsScene(parent)
-{}
+{
+    m_previewTimer.setSingleShot(true);
+    m_previewTimer.setInterval(PREVIEW_INTERVAL_MS);
+    connect(&m_previewTimer, &QTimer::timeout, this, &MapGraphicsScene::showPendingPreview);
+}
 
 MapGraphicsScene::~MapGraphicsScene() {}
 
@@ -24,36 +36,104 @@ const vec_uniq<LayerBlockingItems>& MapGraphicsScene::blockingLayers() const
     return m_blockingLayers;
 }
 
-void MapGraphicsScene::setMap(std::shared_ptr<Project> p, const Dummy::Map& map, const std::vector<QPixmap>& chipsets)
+LayerGraphicItems* MapGraphicsScene::graphicLayer(uint8_t floorIdx, uint8_t layerIdx) const
 {
-    // Clear the scene
-    clear();
+    for (const auto& layer : m_visibleLayers)
+        if (layer->isThisLayer(floorIdx, layerIdx))
+            return layer.get();
+    return nullptr;
+}
 
-    // Clear the loaded layers
-    m_visibleLayers.clear();
-    m_blockingLayers.clear();
-    m_objectsLayers.clear();
+LayerBlockingItems* MapGraphicsScene::blockingLayer(uint8_t floorIdx) const
+{
+    for (const auto& layer : m_blockingLayers)
+        if (layer->isThisFloor(floorIdx))
+            return layer.get();
+    return nullptr;
+}
+
+void MapGraphicsScene::setMap(std::shared_ptr<Project> p, std::shared_ptr<Dummy::Map> map)
+{
+    // Clear the scene and its layers
+    clear();
     m_loadedProject = p;
+    if (map == nullptr)
+        return;
 
-    int zindex            = 0;
-    const size_t nbFloors = map.floors().size();
-    for (uint8_t i = 0; i < nbFloors; ++i) {
-        instantiateFloor(*map.floorAt(i), chipsets, map.chipsetsUsed(), i, zindex);
-    }
+    m_mapToInstantiate = map.get();
     setCurrFloor(0);
+
+    // Blocking masks cost a read of every cell: they are built in parallel, and floors then only attach them
+    // (see instantiateNextFloor). Each layer given to the workers shares the ownership of the map, so the map
+    // outlives them even if the project moves to another one
+    std::vector<std::shared_ptr<const Dummy::BlockingLayer>> blockingLayers;
+    const size_t nbFloors = map->floors().size();
+    for (size_t i = 0; i < nbFloors; ++i)
+        blockingLayers.emplace_back(map, &map->floorAt(static_cast<uint8_t>(i))->blockingLayer());
+    m_blockingMasks = QtConcurrent::mapped(blockingLayers, &buildBlockingMask);
+}
+
+bool MapGraphicsScene::instantiateNextFloor()
+{
+    if (! hasFloorsToInstantiate())
+        return false;
+
+    uint8_t floorIdx = m_nbFloorsInstantiated++;
+
+    // Waits only if the workers are not done with this floor yet
+    QImage blockingMask;
+    if (! m_blockingMasks.isCanceled())
+        blockingMask = m_blockingMasks.resultAt(floorIdx);
+
+    instantiateFloor(*m_mapToInstantiate->floorAt(floorIdx), m_loadedProject->tileAtlas(), blockingMask, floorIdx,
+                     m_nextZIndex);
+
+    if (! hasFloorsToInstantiate()) {
+        m_mapToInstantiate = nullptr;
+        m_blockingMasks    = QFuture<QImage>(); // all the masks are owned by their layers now
+    }
+
+    return true;
+}
+
+bool MapGraphicsScene::hasFloorsToInstantiate() const
+{
+    return m_mapToInstantiate != nullptr && m_nbFloorsInstantiated < m_mapToInstantiate->floors().size();
 }
 
 void MapGraphicsScene::setCurrFloor(uint8_t id)
 {
     m_activeFloor = id;
+
+    // Layers of the other floors release their items, their cache draws them instead
+    for (const auto& layer : m_visibleLayers)
+        layer->setCollapsed(! layer->isThisFloor(id));
+    for (const auto& layer : m_blockingLayers)
+        layer->setCollapsed(! layer->isThisFloor(id));
+
+    const size_t nbCaches = m_floorCaches.size();
+    for (size_t i = 0; i < nbCaches; ++i)
+        m_floorCaches[i]->setVisible(i != id);
 }
 
-void MapGraphicsScene::setPreview(const QPixmap& previewPix, const QPoint& pos)
+void MapGraphicsScene::setPreview(const QRect& rect, const QPixmap& pattern)
+{
+    previewItem(rect).setPattern(pattern);
+}
+void MapGraphicsScene::setPreview(const QRect& rect, const QColor& color)
 {
-    m_previewTileItem = std::make_unique<QGraphicsPixmapItem>(previewPix);
-    m_previewTileItem->setZValue(Z_PREVIEW);
-    m_previewTileItem->setPos(pos);
-    addItem(m_previewTileItem.get());
+    previewItem(rect).setColor(color);
+}
+PreviewItem& MapGraphicsScene::previewItem(const QRect& rect)
+{
+    // A single item is kept, only moved and resized by each preview
+    if (m_previewItem == nullptr) {
+        m_previewItem = std::make_unique<PreviewItem>();
+        addItem(m_previewItem.get());
+    }
+    m_previewItem->setRect(rect);
+    m_previewItem->setVisible(true);
+    return *m_previewItem;
 }
 void MapGraphicsScene::setLocationCharacter(const QPoint& p, Dummy::char_id id)
 {
@@ -66,53 +146,80 @@ void MapGraphicsScene::setLocationCharacter(const QPoint& p, Dummy::char_id id)
 }
 void MapGraphicsScene::setSelectRect(const QRect& selectionRect)
 {
-    clearSelectRect();
-
-    QBrush brush(QColor(66, 135, 245));
-
-    m_selectionRectItem = std::unique_ptr<QGraphicsRectItem>(addRect(selectionRect));
-    m_selectionRectItem->setZValue(Z_SELEC);
-    m_selectionRectItem->setBrush(brush);
-    m_selectionRectItem->setOpacity(0.5);
+    // A single item is kept: moving it only repaints its old and new areas
+    if (m_selectionRectItem == nullptr) {
+        m_selectionRectItem = std::unique_ptr<QGraphicsRectItem>(addRect(QRect()));
+        m_selectionRectItem->setZValue(Z_SELEC);
+        m_selectionRectItem->setBrush(QBrush(QColor(66, 135, 245)));
+        m_selectionRectItem->setOpacity(0.5);
+    }
+    m_selectionRectItem->setRect(selectionRect);
+    m_selectionRectItem->setVisible(true);
 }
 
 void MapGraphicsScene::drawGrid(quint16 width, quint16 height, unsigned int unit)
 {
-    clearGrid();
-
-    QPen pen(QColor(0, 0, 0, 155), 0.5);
-
-    for (int i = 0; i <= width; ++i) {
-        QGraphicsItem* item = addLine(i * unit, 0, i * unit, unit * height, pen);
-        item->setZValue(Z_GRID);
-        m_gridItems.push_back(std::unique_ptr<QGraphicsItem>(item));
+    // A single item draws the whole grid, it is only resized when the layer changes
+    if (m_gridItem == nullptr) {
+        m_gridItem = std::make_unique<GridItem>(QPen(QColor(0, 0, 0, 155), 0.5));
+        addItem(m_gridItem.get());
     }
 
-    for (int i = 0; i <= height; ++i) {
-        QGraphicsItem* item = addLine(0, i * unit, unit * width, unit * i, pen);
-        item->setZValue(Z_GRID);
-        m_gridItems.push_back(std::unique_ptr<QGraphicsItem>(item));
-    }
+    const int iUnit = static_cast<int>(unit);
+    m_gridItem->setGrid(QSize(width * iUnit, height * iUnit), QSize(iUnit, iUnit));
 }
-void MapGraphicsScene::updateTilesets(const std::vector<QPixmap>& tilesets,
-                                      const std::vector<Dummy::chip_id>& chipsetIds)
+void MapGraphicsScene::updateTilesets()
 {
     for (const auto& layerGraph : m_visibleLayers)
-        layerGraph->updateTilesets(tilesets, chipsetIds);
+        layerGraph->updateTilesets();
     update();
 }
 
+void MapGraphicsScene::revealRegion(const QRectF& viewedRect)
+{
+    // Add a margin of 1 chunk so that scrolling a bit doesn't show empty cells
+    const int margin = CHUNK_SIZE;
+    QRect cells(QPoint(static_cast<int>(viewedRect.left()) / CELL_W - margin,
+                       static_cast<int>(viewedRect.top()) / CELL_H - margin),
+                QPoint(static_cast<int>(viewedRect.right()) / CELL_W + margin,
+                       static_cast<int>(viewedRect.bottom()) / CELL_H + margin));
+
+    for (const auto& layer : m_visibleLayers)
+        layer->reveal(cells);
+    for (const auto& layer : m_blockingLayers)
+        layer->reveal(cells);
+}
+
+void MapGraphicsScene::refreshFloor(uint8_t floorIdx)
+{
+    if (floorIdx < m_floorCaches.size())
+        m_floorCaches[floorIdx]->update();
+}
+
 void MapGraphicsScene::clear()
 {
-    clearPreview();
+    // Tools may point to the layers, and layers to the items deleted below
+    if (m_tools != nullptr)
+        m_tools->clear();
+    m_visibleLayers.clear();
+    m_blockingLayers.clear();
+    m_objectsLayers.clear();
+
+    m_mapToInstantiate     = nullptr;
+    m_nbFloorsInstantiated = 0;
+    m_nextZIndex           = 0;
+    m_blockingMasks.cancel();
+    m_floorCaches.clear();
+    m_previewItem.reset();
+    m_selectionRectItem.reset();
     clearLocationIndicator();
-    clearSelectRect();
     clearGrid();
     QGraphicsScene::clear();
 }
 void MapGraphicsScene::clearPreview()
 {
-    m_previewTileItem.reset();
+    if (m_previewItem != nullptr)
+        m_previewItem->setVisible(false);
 }
 void MapGraphicsScene::clearLocationIndicator()
 {
@@ -120,22 +227,36 @@ void MapGraphicsScene::clearLocationIndicator()
 }
 void MapGraphicsScene::clearSelectRect()
 {
-    m_selectionRectItem.reset();
+    if (m_selectionRectItem == nullptr)
+        return;
+
+    m_selectionRectItem->setRect(QRect());
+    m_selectionRectItem->setVisible(false);
 }
 void MapGraphicsScene::clearGrid()
 {
-    m_gridItems.clear();
+    m_gridItem.reset();
 }
 
-void MapGraphicsScene::instantiateFloor(Dummy::Floor& floor, const std::vector<QPixmap>& chips,
-                                        const std::vector<Dummy::chip_id>& chipsetIds, uint8_t floorId, int& zindex)
+void MapGraphicsScene::instantiateFloor(Dummy::Floor& floor, const TileAtlas& atlas, const QImage& blockingMask,
+                                        uint8_t floorId, int& zindex)
 {
+    const bool isActive = (floorId == m_activeFloor);
+
+    // Add the cache drawing the floor when it is not the active one
+    auto* floorCache = new FloorCacheItem(floor.blockingLayer().width(), floor.blockingLayer().height());
+    floorCache->setZValue(zindex + 1);
+    floorCache->setVisible(! isActive);
+    addItem(floorCache);
+    m_floorCaches.push_back(floorCache);
+
     // Add graphic layers
     const size_t nbFloors = floor.graphicLayers().size();
     for (uint8_t i = 0; i < nbFloors; ++i) {
         ++zindex;
-        auto pGraphicLayer =
-            std::make_unique<LayerGraphicItems>(floor.graphicLayersAt(i), chips, chipsetIds, floorId, i, zindex);
+        auto pGraphicLayer = std::make_unique<LayerGraphicItems>(floor.graphicLayersAt(i), atlas, floorId, i, zindex);
+        pGraphicLayer->setCollapsed(! isActive);
+        floorCache->addLayer(*pGraphicLayer);
         addItem(pGraphicLayer->graphicItems());
         m_visibleLayers.push_back(std::move(pGraphicLayer));
     }
@@ -143,7 +264,10 @@ void MapGraphicsScene::instantiateFloor(Dummy::Floor& floor, const std::vector<Q
     // Add 1 blocking layer
     {
         ++zindex;
-        auto pBlockingLayer = std::make_unique<LayerBlockingItems>(floor.blockingLayer(), floorId, 0, zindex);
+        auto pBlockingLayer =
+            std::make_unique<LayerBlockingItems>(floor.blockingLayer(), floorId, 0, zindex, blockingMask);
+        pBlockingLayer->setCollapsed(! isActive);
+        floorCache->addLayer(*pBlockingLayer);
         addItem(pBlockingLayer->graphicItems());
         m_blockingLayers.push_back(std::move(pBlockingLayer));
     }
@@ -202,9 +326,13 @@ void MapGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent* e)
                 objLay->update();
         }
     } else if (m_tools != nullptr && e->button() == Qt::LeftButton) {
-        m_toolMode     = eMode::Tool;
         m_firstClickPt = e->scenePos().toPoint();
-        m_tools->previewTool(QRect(m_firstClickPt, m_firstClickPt));
+        if (m_tools->beginStroke(m_firstClickPt)) {
+            m_toolMode = eMode::Stroke;
+        } else {
+            m_toolMode = eMode::Tool;
+            previewTool(QRect(m_firstClickPt, m_firstClickPt));
+        }
     }
 }
 
@@ -215,7 +343,9 @@ void MapGraphicsScene::mouseMoveEvent(QGraphicsSceneMouseEvent* e)
         m_locationIndicatorItem->setPos(mouseCoord.x * CELL_W, mouseCoord.y * CELL_H);
     } else if (m_toolMode == eMode::Tool && m_tools != nullptr) {
         QPoint otherClick = e->scenePos().toPoint();
-        m_tools->previewTool(QRect(m_firstClickPt, otherClick));
+        previewTool(QRect(m_firstClickPt, otherClick));
+    } else if (m_toolMode == eMode::Stroke && m_tools != nullptr) {
+        m_tools->continueStroke(e->scenePos().toPoint());
     }
 }
 
@@ -233,12 +363,36 @@ void MapGraphicsScene::mouseReleaseEvent(QGraphicsSceneMouseEvent* e)
     }
     // using a map-drawing tool
     else if (m_toolMode == eMode::Tool && m_tools != nullptr) {
-        QPoint otherClick = e->scenePos().toPoint();
+        m_hasPendingPreview = false; // the tool is used right now
+        QPoint otherClick   = e->scenePos().toPoint();
         m_tools->useTool(QRect(m_firstClickPt, otherClick));
     }
+    // end of a freehand stroke
+    else if (m_toolMode == eMode::Stroke && m_tools != nullptr) {
+        m_tools->endStroke();
+    }
     m_toolMode = eMode::None;
 }
 
+void MapGraphicsScene::previewTool(const QRect& clickingRegion)
+{
+    // Mouse moves can come much faster than frames: only the last one is previewed
+    m_pendingPreview    = clickingRegion;
+    m_hasPendingPreview = true;
+    if (! m_previewTimer.isActive())
+        showPendingPreview();
+}
+
+void MapGraphicsScene::showPendingPreview()
+{
+    if (! m_hasPendingPreview || m_toolMode != eMode::Tool || m_tools == nullptr)
+        return;
+
+    m_hasPendingPreview = false;
+    m_tools->previewTool(m_pendingPreview);
+    m_previewTimer.start();
+}
+
 QRectF MapGraphicsScene::selectionRect()
 {
     if (m_selectionRectItem == nullptr)
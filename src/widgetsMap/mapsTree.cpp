@@ -109,7 +109,8 @@ void MapsTreeView::createMap(int result)
     mapInfo.m_width       = m_newMapDialog->getWidth();
     mapInfo.m_height      = m_newMapDialog->getHeight();
 
-    m_project->createMap(mapInfo, *selectedParentMap);
+    if (! m_project->createMap(mapInfo, *selectedParentMap))
+        return;
 
     expand(m_selectedIndex);
 
@@ -138,6 +139,7 @@ void MapsTreeView::editMap(int result)
 
     if (w != map->width() || h != map->height()) {
         map->resize(w, h);
+        m_project->mapChanged();
     }
 
     emit mapChanged(m_editDialog->getMapName());
@@ -146,7 +148,8 @@ void MapsTreeView::editMap(int result)
 void MapsTreeView::showEditDlg()
 {
     const QString mapName = m_project->mapsModel()->itemFromIndex(m_selectedIndex)->text();
-    m_project->loadMap(mapName);
+    if (! m_project->loadMap(mapName))
+        return; // the dialog would edit another map
     const auto* map = m_project->currMap();
 
     m_editDialog->setup(*m_project, map, mapName);
@@ -196,4 +199,24 @@ void MapsTreeModel::renameNode(const QString& oldName, const QString& newName)
     for (int i = 0; i < nbItems; ++i)
         oldNameItems[i]->setText(newName);
 }
+
+QStringList MapsTreeModel::neighbourMaps(const QString& mapName) const
+{
+    QStringList neighbours;
+    const auto mapItems = findItems(mapName, Qt::MatchExactly | Qt::MatchRecursive);
+    if (mapItems.isEmpty())
+        return neighbours;
+
+    const QStandardItem* mapItem = mapItems[0];
+    const QStandardItem* parent  = mapItem->parent() != nullptr ? mapItem->parent() : invisibleRootItem();
+    if (parent != invisibleRootItem())
+        neighbours << parent->text();
+    for (int i = 0; i < parent->rowCount(); ++i)
+        if (parent->child(i) != mapItem)
+            neighbours << parent->child(i)->text();
+    for (int i = 0; i < mapItem->rowCount(); ++i)
+        neighbours << mapItem->child(i)->text();
+
+    return neighbours;
+}
 } // namespace Editor
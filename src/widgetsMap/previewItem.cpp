@@ -0,0 +1,57 @@
+#include "widgetsMap/previewItem.hpp"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "utils/definitions.hpp"
+
+namespace Editor {
+
+PreviewItem::PreviewItem()
+{
+    // we need the exposed rect to only fill what needs it
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    setZValue(Z_PREVIEW);
+}
+
+void PreviewItem::setRect(const QRect& rect)
+{
+    if (rect == m_rect)
+        return;
+
+    prepareGeometryChange();
+    m_rect = rect;
+}
+
+void PreviewItem::setPattern(const QPixmap& pattern)
+{
+    if (m_patternKey == pattern.cacheKey())
+        return;
+
+    m_patternKey = pattern.cacheKey();
+    m_brush      = QBrush(pattern); // implicitly shared, no pixel is copied
+    update();
+}
+
+void PreviewItem::setColor(const QColor& color)
+{
+    if (m_patternKey == 0 && m_brush.style() == Qt::SolidPattern && m_brush.color() == color)
+        return;
+
+    m_patternKey = 0;
+    m_brush      = QBrush(color);
+    update();
+}
+
+QRectF PreviewItem::boundingRect() const
+{
+    return m_rect;
+}
+
+void PreviewItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    // The pattern starts on the top-left cell of the rect, as when it is drawn for real
+    painter->setBrushOrigin(m_rect.topLeft());
+    painter->fillRect(option->exposedRect.intersected(m_rect), m_brush);
+}
+} // namespace Editor
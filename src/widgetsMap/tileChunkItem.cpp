@@ -0,0 +1,45 @@
+#include "widgetsMap/tileChunkItem.hpp"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+
+#include "utils/definitions.hpp"
+#include "widgetsMap/layerItems.hpp"
+
+namespace Editor {
+
+TileChunkItem::TileChunkItem(const MapSceneLayer& layer, const QRect& cells)
+    : m_layer(layer)
+    , m_cells(cells)
+{
+    // we need the exposed rect to only paint the cells that need it
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF TileChunkItem::boundingRect() const
+{
+    return QRectF(m_cells.x() * CELL_W, m_cells.y() * CELL_H, m_cells.width() * CELL_W, m_cells.height() * CELL_H);
+}
+
+void TileChunkItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    const QRectF exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty())
+        return;
+
+    // Convert exposed area to the range of cells to redraw
+    const int minX = std::max(static_cast<int>(exposed.left()) / CELL_W, m_cells.left());
+    const int minY = std::max(static_cast<int>(exposed.top()) / CELL_H, m_cells.top());
+    const int maxX = std::min(static_cast<int>(exposed.right()) / CELL_W, m_cells.right());
+    const int maxY = std::min(static_cast<int>(exposed.bottom()) / CELL_H, m_cells.bottom());
+
+    m_layer.paintCells(*painter, QRect(QPoint(minX, minY), QPoint(maxX, maxY)));
+}
+
+void TileChunkItem::invalidateCell(Dummy::Coord coord)
+{
+    update(QRectF(coord.x * CELL_W, coord.y * CELL_H, CELL_W, CELL_H));
+}
+
+} // namespace Editor